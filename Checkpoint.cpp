@@ -0,0 +1,127 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "Checkpoint.h"
+
+namespace {
+  const char * header = "ic3ref-checkpoint 1";
+
+  // Reads the keyword and checks that it is the expected one.
+  bool expect(istream & in, const char * word) {
+    string w;
+    return (in >> w) && w == word;
+  }
+}
+
+bool Checkpoint::read(const string & file) {
+  ifstream in(file.c_str());
+  string line;
+  if (!getline(in, line) || line != header) return false;
+  size_t nCounts, nFrames;
+  if (!expect(in, "model") || !(in >> hex >> modelHash >> dec)
+      || !expect(in, "k") || !(in >> k)
+      || !expect(in, "stats")
+      || !(in >> queries >> ctis >> ctgs >> mics >> cpuTime >> satTime)
+      || !expect(in, "order") 
+      || !(in >> inc >> numLits >> numUpdates >> nCounts))
+    return false;
+  counts.resize(nCounts);
+  for (size_t i = 0; i < nCounts; ++i)
+    if (!(in >> counts[i])) return false;
+  if (!expect(in, "frames") || !(in >> nFrames)) return false;
+  frames.assign(nFrames, vector<LitVec>());
+  for (size_t i = 0; i < nFrames; ++i) {
+    size_t level, nCubes;
+    if (!(in >> level >> nCubes) || level != i) return false;
+    getline(in, line);
+    frames[i].resize(nCubes);
+    for (size_t j = 0; j < nCubes; ++j) {
+      if (!getline(in, line)) return false;
+      stringstream ss(line);
+      int lit;
+      while (ss >> lit) {
+        if (lit < 0) return false;
+        frames[i][j].push_back(Minisat::toLit(lit));
+      }
+      if (frames[i][j].empty()) return false;
+    }
+  }
+  return true;
+}
+
+bool Checkpoint::write(const string & file) const {
+  string tmp = file + ".tmp";
+  ofstream out(tmp.c_str());
+  // enough digits for the doubles to read back unchanged
+  out << setprecision(17);
+  out << header << endl;
+  out << "model " << hex << modelHash << dec << endl;
+  out << "k " << k << endl;
+  out << "stats " << queries << " " << ctis << " " << ctgs << " " << mics
+      << " " << cpuTime << " " << satTime << endl;
+  out << "order " << inc << " " << numLits << " " << numUpdates << " " 
+      << counts.size();
+  for (size_t i = 0; i < counts.size(); ++i)
+    out << " " << counts[i];
+  out << endl;
+  out << "frames " << frames.size() << endl;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    out << i << " " << frames[i].size() << endl;
+    for (size_t j = 0; j < frames[i].size(); ++j) {
+      for (size_t l = 0; l < frames[i][j].size(); ++l)
+        out << (l ? " " : "") << Minisat::toInt(frames[i][j][l]);
+      out << endl;
+    }
+  }
+  out.close();
+  if (out && rename(tmp.c_str(), file.c_str()) == 0) return true;
+  remove(tmp.c_str());
+  return false;
+}
+
+bool Checkpoint::fits(const Model & model) const {
+  if (modelHash != model.structuralHash()) return false;
+  // IC3 keeps frames 0 through k+1, and none has lemmas at level 0
+  if (k < 1 || frames.size() > k+2 || (!frames.empty() && !frames[0].empty()))
+    return false;
+  if (counts.size() > model.numUnprimedVars() || !(inc > 0)) return false;
+  // each lemma is a cube over the latches
+  size_t lo = 0, hi = 0;
+  if (model.beginLatches() != model.endLatches()) {
+    lo = model.beginLatches()->index();
+    hi = lo + (model.endLatches() - model.beginLatches());
+  }
+  for (size_t i = 0; i < frames.size(); ++i)
+    for (size_t j = 0; j < frames[i].size(); ++j)
+      for (size_t l = 0; l < frames[i][j].size(); ++l) {
+        size_t v = (size_t) Minisat::var(frames[i][j][l]);
+        if (v < lo || v >= hi) return false;
+      }
+  return true;
+}
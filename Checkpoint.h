@@ -0,0 +1,73 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Model.h"
+
+// The state of an IC3 run at a point where its frames are consistent
+// (the end of a major iteration, or a safe stopping point), from
+// which a later run on the same model can continue at the same k
+// instead of deriving the lemmas again.  The lemmas are over the
+// Model's own latches, so a checkpoint is tied to its model by
+// Model::structuralHash().
+//
+// It is kept as text: a header line, then "model <hash>", "k <k>",
+// "stats" with the counters and CPU seconds, "order" with the
+// literal-ordering state, and "frames <n>", each frame being
+// "<level> <#lemmas>" followed by one line of literals per lemma.
+struct Checkpoint {
+  Checkpoint() : 
+    modelHash(0), k(0), inc(1), numLits(0), numUpdates(0),
+    queries(0), ctis(0), ctgs(0), mics(0), cpuTime(0), satTime(0) {}
+
+  uint64_t modelHash;
+  size_t k;
+  vector<vector<LitVec> > frames;  // cubes of each frame, by level
+  // HeuristicLitOrder's counts and increment, and the averages
+  vector<double> counts;
+  double inc, numLits, numUpdates;
+  // statistics
+  uint64_t queries, ctis, ctgs, mics;
+  double cpuTime, satTime;  // seconds
+
+  // Reads a checkpoint; false if the file cannot be read or is not a
+  // well-formed checkpoint.
+  bool read(const string & file);
+  // Writes the checkpoint to a temporary file that then replaces
+  // file, so that file always holds a complete checkpoint; false on
+  // failure.
+  bool write(const string & file) const;
+
+  // Is this a checkpoint of a run on the model: are its hash, its
+  // frames, and its literals consistent with it?
+  bool fits(const Model & model) const;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include "CubeStore.h"
+
+const CubeId CubeStore::NoCube;
+
+// FNV-1a over the literal codes.
+uint64_t CubeStore::hashOf(const LitVec & cube) {
+  uint64_t h = 14695981039346656037ULL;
+  for (LitVec::const_iterator i = cube.begin(); i != cube.end(); ++i) {
+    h ^= (uint64_t) (uint32_t) Minisat::toInt(*i);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+bool CubeStore::equal(CubeId id, const LitVec & cube) const {
+  if (entries[id].size != cube.size()) return false;
+  const Minisat::Lit * l = begin(id);
+  for (size_t i = 0; i < cube.size(); ++i)
+    if (l[i] != cube[i]) return false;
+  return true;
+}
+
+// Doubles the table (keeping it at most half full) and reinserts all
+// ids.
+void CubeStore::rehash() {
+  size_t cap = table.empty() ? 1024 : 2 * table.size();
+  table.assign(cap, NoCube);
+  mask = cap - 1;
+  for (CubeId id = 0; id < entries.size(); ++id) {
+    size_t s = entries[id].hash & mask;
+    while (table[s] != NoCube) s = (s + 1) & mask;
+    table[s] = id;
+  }
+}
+
+CubeId CubeStore::find(const LitVec & cube) const {
+  if (table.empty()) return NoCube;
+  uint64_t h = hashOf(cube);
+  for (size_t s = h & mask; table[s] != NoCube; s = (s + 1) & mask) {
+    CubeId id = table[s];
+    if (entries[id].hash == h && equal(id, cube)) return id;
+  }
+  return NoCube;
+}
+
+CubeId CubeStore::intern(const LitVec & cube) {
+  if (2 * (entries.size() + 1) > table.size()) rehash();
+  uint64_t h = hashOf(cube);
+  size_t s = h & mask;
+  for (; table[s] != NoCube; s = (s + 1) & mask) {
+    CubeId id = table[s];
+    if (entries[id].hash == h && equal(id, cube)) return id;
+  }
+  Entry e;
+  e.offset = (uint32_t) arena.size();
+  e.size = (uint32_t) cube.size();
+  e.hash = h;
+  e.sig = 0;
+  for (LitVec::const_iterator i = cube.begin(); i != cube.end(); ++i)
+    e.sig |= 1ULL << (Minisat::toInt(*i) & 63);
+  arena.insert(arena.end(), cube.begin(), cube.end());
+  CubeId id = (CubeId) entries.size();
+  entries.push_back(e);
+  table[s] = id;
+  return id;
+}
+
+size_t SubsumptionIndex::bytes() const {
+  size_t b = occurs.capacity() * sizeof(CubeIdVec);
+  for (vector<CubeIdVec>::const_iterator i = occurs.begin(); 
+       i != occurs.end(); ++i)
+    b += i->capacity() * sizeof(CubeId);
+  return b;
+}
+
+void SubsumptionIndex::insert(CubeId id) {
+  for (const Minisat::Lit * l = store.begin(id); l != store.end(id); ++l) {
+    size_t li = (size_t) Minisat::toInt(*l);
+    if (li >= occurs.size()) occurs.resize(li+1);
+    occurs[li].push_back(id);
+  }
+}
+
+void SubsumptionIndex::erase(CubeId id) {
+  for (const Minisat::Lit * l = store.begin(id); l != store.end(id); ++l) {
+    CubeIdVec & occ = occurs[(size_t) Minisat::toInt(*l)];
+    CubeIdVec::iterator i = find(occ.begin(), occ.end(), id);
+    assert (i != occ.end());
+    *i = occ.back();
+    occ.pop_back();
+  }
+}
+
+// Both cubes are sorted.
+bool SubsumptionIndex::subset(CubeId a, CubeId b) const {
+  const Minisat::Lit * i = store.begin(a), * j = store.begin(b);
+  const Minisat::Lit * ie = store.end(a), * je = store.end(b);
+  for (; i != ie; ++i) {
+    while (j != je && *j < *i) ++j;
+    if (j == je || *j != *i) return false;
+    ++j;
+  }
+  return true;
+}
+
+void SubsumptionIndex::subsets(CubeId id, CubeIdVec & out) const {
+  size_t sz = store.size(id);
+  uint64_t s = store.sig(id);
+  for (const Minisat::Lit * l = store.begin(id); l != store.end(id); ++l) {
+    size_t li = (size_t) Minisat::toInt(*l);
+    if (li >= occurs.size()) continue;
+    const CubeIdVec & occ = occurs[li];
+    for (CubeIdVec::const_iterator i = occ.begin(); i != occ.end(); ++i)
+      // visit each candidate once: through its smallest literal
+      if (*i != id && *store.begin(*i) == *l && store.size(*i) <= sz
+          && !(store.sig(*i) & ~s) && subset(*i, id))
+        out.push_back(*i);
+  }
+}
+
+void SubsumptionIndex::supersets(CubeId id, CubeIdVec & out) const {
+  // every superset occurs in the shortest list of id's literals
+  const CubeIdVec * occ = NULL;
+  for (const Minisat::Lit * l = store.begin(id); l != store.end(id); ++l) {
+    size_t li = (size_t) Minisat::toInt(*l);
+    if (li >= occurs.size()) return;
+    if (!occ || occurs[li].size() < occ->size()) occ = &occurs[li];
+  }
+  if (!occ) return;
+  size_t sz = store.size(id);
+  uint64_t s = store.sig(id);
+  for (CubeIdVec::const_iterator i = occ->begin(); i != occ->end(); ++i)
+    if (*i != id && store.size(*i) >= sz && !(s & ~store.sig(*i))
+        && subset(id, *i))
+      out.push_back(*i);
+}
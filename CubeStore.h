@@ -0,0 +1,121 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#ifndef CUBESTORE_H_INCLUDED
+#define CUBESTORE_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+#include "Model.h"
+
+// Stable identifier of an interned cube.
+typedef uint32_t CubeId;
+typedef vector<CubeId> CubeIdVec;
+
+// Interns cubes: each distinct (sorted) cube is stored exactly once in
+// a contiguous arena of literals, together with a 64-bit hash, and is
+// named by a CubeId that remains valid for the lifetime of the store.
+// Frames can then hold lemmas as lists of ids, so that a lemma pushed
+// from one frame to the next moves by id rather than by copy.  Cubes
+// are never removed.
+class CubeStore {
+public:
+  CubeStore() : mask(0) {}
+
+  // Returns the id of the given sorted cube, interning it first if it
+  // has not been seen before.
+  CubeId intern(const LitVec & cube);
+  // Returns the id of the given sorted cube, or NoCube if it has not
+  // been interned.
+  CubeId find(const LitVec & cube) const;
+  static const CubeId NoCube = (CubeId) -1;
+
+  size_t size(CubeId id) const { return entries[id].size; }
+  uint64_t hash(CubeId id) const { return entries[id].hash; }
+  // A 64-bit signature with bit (l mod 64) set for each literal l, so
+  // that sig(a) & ~sig(b) != 0 implies that a is not a subset of b.
+  uint64_t sig(CubeId id) const { return entries[id].sig; }
+  // WARNING: do not keep these pointers across intern() calls.
+  const Minisat::Lit * begin(CubeId id) const {
+    return arena.data() + entries[id].offset;
+  }
+  const Minisat::Lit * end(CubeId id) const {
+    return begin(id) + entries[id].size;
+  }
+  // Copies the literals of the given cube into cube.
+  void get(CubeId id, LitVec & cube) const {
+    cube.assign(begin(id), end(id));
+  }
+
+  size_t numCubes() const { return entries.size(); }
+  size_t numLits() const { return arena.size(); }
+  size_t bytes() const {
+    return arena.capacity() * sizeof(Minisat::Lit)
+      + entries.capacity() * sizeof(Entry) + table.capacity() * sizeof(CubeId);
+  }
+
+private:
+  struct Entry {
+    uint32_t offset, size;
+    uint64_t hash, sig;
+  };
+  LitVec arena;
+  vector<Entry> entries;
+  // Open-addressed hash table of ids; empty slots hold NoCube.
+  vector<CubeId> table;
+  size_t mask;
+
+  static uint64_t hashOf(const LitVec & cube);
+  bool equal(CubeId id, const LitVec & cube) const;
+  void rehash();
+};
+
+// Occurrence lists over a subset of the cubes of a CubeStore (for
+// IC3, the current lemmas), used to find the indexed cubes that
+// subsume, or are subsumed by, a given cube.  Candidates are filtered
+// by size and signature before their literals are compared.
+class SubsumptionIndex {
+public:
+  SubsumptionIndex(const CubeStore & _store) : store(_store) {}
+
+  void insert(CubeId id);
+  void erase(CubeId id);
+
+  // Appends to out the indexed cubes, other than id, that are subsets
+  // of id's cube.
+  void subsets(CubeId id, CubeIdVec & out) const;
+  // Appends to out the indexed cubes, other than id, that are
+  // supersets of id's cube.
+  void supersets(CubeId id, CubeIdVec & out) const;
+
+  size_t bytes() const;
+
+private:
+  const CubeStore & store;
+  vector<CubeIdVec> occurs;  // indexed by literal
+
+  bool subset(CubeId a, CubeId b) const;
+};
+
+#endif
@@ -22,11 +22,24 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <mutex>
 #include <set>
+#include <sys/resource.h>
 #include <sys/times.h>
+#include <thread>
 
+#include "CubeStore.h"
+#include "LemmaChannel.h"
+#include "Profile.h"
+#include "TernarySim.h"
 #include "IC3.h"
 #include "Solver.h"
 #include "Vec.h"
@@ -60,7 +73,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //    In particular, if s with inputs i is a predecessor of t, then s
 //    & i & T & ~t' is unsatisfiable, where T is the transition
 //    relation.  The unsat core reveals a suitable lifting of s.  See
-//    stateOf().
+//    stateOf().  Optionally (-t), the lifting is first attempted by
+//    ternary simulation, as in Een et al.'s paper; see TernarySim.
 //
 //  o One solver per frame, which various authors of IC3
 //    implementations have tried (including me in pre-publication
@@ -113,8 +127,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 // Limitations in roughly descending order of significance:
 //
-//  o A permanent limitation is that there is absolutely no
-//    simplification of the AIGER spec.  Use, e.g.,
+//  o The only simplification of the AIGER spec is the light,
+//    optional preprocessing of Preprocess.cpp.  For more, use, e.g.,
 //
 //      iimc -t pp -t print_aiger 
 //
@@ -129,40 +143,53 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace IC3 {
 
+  // Set by interrupt(): every running instance stops at its next safe
+  // point.
+  static std::atomic<bool> interrupted(false);
+
+  void interrupt() {
+    interrupted.store(true, std::memory_order_relaxed);
+  }
+
   class IC3 {
   public:
     IC3(Model & _model) :
       inductive_frame(-1),
-      verbose(0), random(false), model(_model), k(1), nextState(0),
-      litOrder(), slimLitOrder(),
+      verbose(0), random(false), threads(1), seed(0), stop(NULL),
+      deadline(0), memShare(NULL), abandoned(false),
+      channel(NULL), worker(0), channelCursor(0), publishing(true), json(NULL),
+      checkpointFile(NULL), resume(NULL),
+      background(NULL), aigMap(NULL), model(_model), k(1), freeStates(0),
+      subsumption(cubes), oneSolver(false),
+      tsim(NULL), litOrder(),
       numLits(0), numUpdates(0), maxDepth(1), maxCTGs(3),
-      maxJoins(1<<20), micAttempts(3), cexState(0), nQuery(0), nCTI(0), nCTG(0),
-      nmic(0), satTime(0), nCoreReduced(0), nAbortJoin(0), nAbortMic(0)
+      maxJoins(1<<20), micAttempts(3), chunked(false),
+      micThreads(1), dropBatch(0), dropPending(0), dropQuit(false),
+      lemmaStamp(0),
+      cexState(0), memLimit(0), memChecked(0), memFloor(0),
+      nQuery(0), nCTI(0), nCTG(0),
+      nmic(0), satTime(0), simTime(0), nSimLifts(0), nCoreReduced(0), nAbortJoin(0), nAbortMic(0),
+      nFwdSubsumed(0), nBwdSubsumed(0), nRecycled(0), recycleTime(0),
+      nChunkQueries(0), nChunkDropped(0), nSpecQueries(0), nSpecDropped(0),
+      nSpecReused(0),
+      nImportTried(0), nImported(0), nReclaims(0)
     {
-      slimLitOrder.heuristicLitOrder = &litOrder;
-
-      // construct lifting solver
-      lifts = model.newSolver();
-      // don't assert primed invariant constraints
-      model.loadTransitionRelation(*lifts, false);
-      // assert notInvConstraints (in stateOf) when lifting
-      notInvConstraints = Minisat::mkLit(lifts->newVar());
-      Minisat::vec<Minisat::Lit> cls;
-      cls.push(~notInvConstraints);
-      for (LitVec::const_iterator i = model.invariantConstraints().begin();
-           i != model.invariantConstraints().end(); ++i)
-        cls.push(model.primeLit(~*i));
-      lifts->addClause_(cls);
+      buildLifts();
     }
     ~IC3() {
       for (vector<Frame>::const_iterator i = frames.begin(); 
            i != frames.end(); ++i)
-        if (i->consecution) delete i->consecution;
+        if (i->consecution && (!oneSolver || i == frames.begin()))
+          delete i->consecution;
       delete lifts;
+      if (tsim) delete tsim;
+      stopDropWorkers();
     }
 
     void insert_helper_clause(const ClauseBuf & clsbuf, unsigned fidx) {
       assert(fidx < frames.size());
+      // every instance is given the same helper clauses
+      publishing = false;
       for (const auto & clause : clsbuf.clauses) {
         vector<Minisat::Lit> cls;
         for (int lit : clause) {
@@ -170,11 +197,13 @@ namespace IC3 {
         }
         addCube(fidx, cls);
       }
+      publishing = true;
     }
 
     // The main loop.
     bool check(const ClauseBuf & clsbuf) {
       startTime = time();  // stats
+      if (resume) restore(*resume);
       bool first_frame = true;
       while (true) {
         if (verbose > 1) cout << "Level " << k << endl;
@@ -186,22 +215,86 @@ namespace IC3 {
         }
 
         if (!strengthen()) return false;  // strengthen to remove bad successors
+        if (stopped()) {                  // cancelled or out of budget
+          abandoned = true;
+          return false;
+        }
 
         if (propagate()) return true;     // propagate clauses; check for proof
         printStats();
-
+        if (json) writeProfile(*json, "frame");
+        if (checkpointFile) saveCheckpoint();
 
         ++k;                              // increment frontier
       }
     }
 
+    // Writes the frames, the literal order, and the statistics to
+    // checkpointFile.  Every lemma is valid whenever IC3 can stop, so
+    // this may be called at any such point.
+    void saveCheckpoint() {
+      Checkpoint cp;
+      cp.modelHash = model.structuralHash();
+      cp.k = k;
+      cp.frames.resize(frames.size());
+      for (size_t i = 1; i < frames.size(); ++i) {
+        compact(i);
+        for (CubeIdVec::const_iterator j = frames[i].borderCubes.begin();
+             j != frames[i].borderCubes.end(); ++j)
+          cp.frames[i].push_back(LitVec(cubes.begin(*j), cubes.end(*j)));
+      }
+      cp.counts = litOrder.counts;
+      cp.inc = litOrder.inc;
+      cp.numLits = numLits;
+      cp.numUpdates = numUpdates;
+      cp.queries = nQuery;
+      cp.ctis = nCTI;
+      cp.ctgs = nCTG;
+      cp.mics = nmic;
+      cp.cpuTime = (double) (time() - startTime) / sysconf(_SC_CLK_TCK);
+      cp.satTime = (double) satTime / sysconf(_SC_CLK_TCK);
+      if (!cp.write(checkpointFile))
+        cout << "Unable to write checkpoint to " << checkpointFile << endl;
+    }
+
+    // Rebuilds the frames of a checkpointed run, which fits the model,
+    // and takes over its literal order and statistics.  As the lemmas
+    // were all valid in that run, they are added without checks.
+    void restore(const Checkpoint & cp) {
+      k = cp.k;
+      extend();
+      // highest levels first, so that fewer cubes are subsumed later
+      publishing = false;
+      for (size_t i = cp.frames.size(); i-- > 1; )
+        for (size_t j = 0; j < cp.frames[i].size(); ++j) {
+          LitVec cube = cp.frames[i][j];
+          addCube(i, cube, true, true);
+        }
+      publishing = true;
+      litOrder.counts = cp.counts;
+      litOrder.inc = cp.inc;
+      numLits = (float) cp.numLits;
+      numUpdates = (float) cp.numUpdates;
+      nQuery = (int) cp.queries;
+      nCTI = (int) cp.ctis;
+      nCTG = (int) cp.ctgs;
+      nmic = (int) cp.mics;
+      // so that the rates and shares of printStats() cover both runs
+      startTime -= (clock_t) (cp.cpuTime * sysconf(_SC_CLK_TCK));
+      satTime = (clock_t) (cp.satTime * sysconf(_SC_CLK_TCK));
+    }
+
     // Follows and prints chain of states from cexState forward.
    void printWitness() {
       if (cexState != 0) {
         size_t curr = cexState;
+        LitVec inputs, latches;
         while (curr) {
-          cout << stringOfLitVec(state(curr).inputs) 
-               << stringOfLitVec(state(curr).latches) << endl;
+          getLits(state(curr).inputs, inputs);
+          getLits(state(curr).latches, latches);
+          cout << stringOfLitVec(inputs) 
+               << (aigMap ? originalStateString(latches) 
+                          : stringOfLitVec(latches)) << endl;
           curr = state(curr).successor;
         }
       }
@@ -210,26 +303,134 @@ namespace IC3 {
   void printInvariant() {
     // HZ: IC3 might terminate while propagation (when all pushed)
     //     so it might not be appropriate to use the last frame
-    auto & flast = (inductive_frame != -1) ? frames.at(inductive_frame+1) : frames.back();
+    size_t last = (inductive_frame != -1) ? inductive_frame+1 : frames.size()-1;
     cout << "unsat frame is #" << inductive_frame << endl;
+    printFrames("unsat", last, last);
+  }
+
+  // For a run that stopped before a result: the lemmas of all frames,
+  // which are the clauses of F_1, so that -f can load them into
+  // frame 1 of a later run.
+  void printPartial() {
+    printFrames("unknown", 1, frames.size()-1);
+  }
+
+  // Writes the lemmas of frames first through last to inv.cnf (and
+  // stdout) under the given status.
+  void printFrames(const char * status, size_t first, size_t last) {
+    // cubes over the latches of the original AIG
+    vector<vector<int> > inv;
+    for (size_t i = first; i <= last; ++i) {
+      compact(i);
+      for (auto id : frames.at(i).borderCubes) {
+        vector<int> cube;
+        for (const Minisat::Lit * lit = cubes.begin(id); lit != cubes.end(id); ++lit)
+          cube.push_back(lit->x);
+        if (aigMap) aigMap->toOriginal(cube);
+        inv.push_back(cube);
+      }
+    }
+    if (aigMap) aigMap->equivalenceCubes(inv);
     std::ofstream fout("inv.cnf");
-    fout << "unsat " << flast.borderCubes.size() << " " << frames.size() << endl;
-    cout << "unsat " << flast.borderCubes.size() << " " << frames.size() << endl;
-    for( auto & clause : flast.borderCubes) {
-      for (auto & lit : clause) {
-        cout << lit.x << " ";
-        fout << lit.x << " ";
+    fout << status << " " << inv.size() << " " << frames.size() << endl;
+    cout << status << " " << inv.size() << " " << frames.size() << endl;
+    for (auto & cube : inv) {
+      for (int lit : cube) {
+        cout << lit << " ";
+        fout << lit << " ";
       }
       cout << endl;
       fout << endl;
     }
   }
 
+    // Appends the cubes whose negations, together with the background
+    // cubes, form the inductive invariant found by check().
+    void invariantCubes(vector<LitVec> & out) {
+      assert (inductive_frame != -1);
+      for (size_t i = inductive_frame+1; i < frames.size(); ++i) {
+        compact(i);
+        for (CubeIdVec::const_iterator j = frames[i].borderCubes.begin();
+             j != frames[i].borderCubes.end(); ++j)
+          out.push_back(LitVec(cubes.begin(*j), cubes.end(*j)));
+      }
+    }
+
     int inductive_frame;
   private:
 
     int verbose; // 0: silent, 1: stats, 2: all
     bool random;
+    unsigned threads;  // for clause propagation
+    unsigned seed;     // for random runs
+
+    // Set by the portfolio to cancel this instance.  It is polled at
+    // points where IC3 can stop without harm; check() then returns
+    // false, which the portfolio ignores.
+    const std::atomic<bool> * stop;
+    // The instance also stops at the deadline (a Profile::now() time,
+    // if non-zero), on interrupt(), and when the process runs out of
+    // memory (see checkMemory()).
+    uint64_t deadline;
+
+    // What the instances of a run, which share the process and so its
+    // memory limit, know about memory: whether each has reclaimed
+    // memory since the process went over the limit, and whether they
+    // have given up.
+    struct MemShare {
+      MemShare(unsigned n) : reclaimed(n, false), pressed(false),
+                             outOfMemory(false) {}
+      std::mutex mutex;
+      vector<char> reclaimed;          // by worker; guarded by mutex
+      std::atomic<bool> pressed;       // some reclaimed[i] is set
+      std::atomic<bool> outOfMemory;
+    };
+    MemShare * memShare;
+
+    bool stopped() const {
+      return (memShare
+              && memShare->outOfMemory.load(std::memory_order_relaxed))
+        || interrupted.load(std::memory_order_relaxed)
+        || (stop && stop->load(std::memory_order_relaxed))
+        || (deadline && Profile::now() >= deadline);
+    }
+    // Set when check() returns false because the instance stopped
+    // rather than because it found a counterexample.
+    bool abandoned;
+
+    // If set, the portfolio instances exchange lemmas through this
+    // channel: addCube() publishes each lemma, tagged with its level,
+    // and importLemmas() takes in those of the other instances.  A
+    // received lemma was derived over another instance's frames, which
+    // need not agree with this instance's frames of the same index, so
+    // it is only adopted once it passes initiation and consecution
+    // here.  As the channel may lose lemmas, none is relied upon.
+    LemmaChannel * channel;
+    unsigned worker;        // this instance's producer id
+    size_t channelCursor;   // next channel position to receive
+    bool publishing;        // unset while adding received lemmas
+    vector<SharedLemma> received;  // scratch for importLemmas()
+
+    // If set, a JSON record of the profile is written to it at the end
+    // of each major iteration.
+    std::ostream * json;
+
+    // If set, the run is checkpointed to this file at the end of each
+    // major iteration (see saveCheckpoint()).
+    const char * checkpointFile;
+    // If set, check() starts from this checkpoint rather than from
+    // scratch.
+    const Checkpoint * resume;
+
+    // Cubes whose negations are known to hold in all reachable states,
+    // e.g., the invariant of a property proved earlier.  They are
+    // asserted in every frame, including those added later, but are
+    // not lemmas of any frame: they never need to be pushed.
+    const vector<LitVec> * background;
+
+    // Relates the latches to those of the AIG before preprocessing,
+    // if any; used to state the invariant in terms of the original.
+    const AigMap * aigMap;
 
     string stringOfLitVec(const LitVec & vec) {
       stringstream ss;
@@ -238,77 +439,87 @@ namespace IC3 {
       return ss.str();
     }
 
+    // A state over the latches of the AIG before preprocessing.
+    string originalStateString(const LitVec & latches) {
+      vector<int> st;
+      for (LitVec::const_iterator i = latches.begin(); i != latches.end(); ++i)
+        st.push_back(i->x);
+      aigMap->stateToOriginal(st);
+      stringstream ss;
+      for (vector<int>::const_iterator i = st.begin(); i != st.end(); ++i)
+        ss << (aiger_sign(*i) ? "~" : "") << aigMap->latchName(*i) << " ";
+      return ss.str();
+    }
+
     Model & model;
     size_t k;
 
     // The State structures are for tracking trees of (lifted) CTIs.
     // Because States are created frequently, I want to avoid dynamic
     // memory management; instead their (de)allocation is handled via
-    // a vector-based pool.
+    // a vector-based pool with an intrusive free list, and their
+    // literals are bump-allocated in an arena that is reset, along
+    // with the pool, after each CTI has been handled.  Literals of
+    // deleted States stay in the arena until then.
+    struct Span {
+      size_t offset, size;  // into stateLits
+    };
     struct State {
-      size_t successor;  // successor State
-      LitVec latches;
-      LitVec inputs;
-      size_t index;      // for pool
-      bool used;         // for pool
+      size_t successor;  // successor State; next free State if free
+      Span latches;
+      Span inputs;
     };
     vector<State> states;
-    size_t nextState;
+    size_t freeStates;  // head of the free list (0 if empty)
+    LitVec stateLits;
     // WARNING: do not keep reference across newState() calls
     State & state(size_t sti) { return states[sti-1]; }
     size_t newState() {
-      if (nextState >= states.size()) {
-        states.resize(states.size()+1);
-        states.back().index = states.size();
-        states.back().used = false;
-      }
-      size_t ns = nextState;
-      assert (!states[ns].used);
-      states[ns].used = true;
-      while (nextState < states.size() && states[nextState].used)
-        nextState++;
-      return ns+1;
+      if (freeStates) {
+        size_t st = freeStates;
+        freeStates = state(st).successor;
+        return st;
+      }
+      states.push_back(State());
+      return states.size();
     }
     void delState(size_t sti) {
-      State & st = state(sti);
-      st.used = false;
-      st.latches.clear();
-      st.inputs.clear();
-      if (nextState > st.index-1) nextState = st.index-1;
+      state(sti).successor = freeStates;
+      freeStates = sti;
     }
     void resetStates() {
-      for (vector<State>::iterator i = states.begin(); i != states.end(); ++i) {
-        i->used = false;
-        i->latches.clear();
-        i->inputs.clear();
-      }
-      nextState = 0;
+      states.clear();
+      freeStates = 0;
+      stateLits.clear();
     }
-
-    // A CubeSet is a set of ordered (by integer value) vectors of
-    // Minisat::Lits.
-    static bool _LitVecComp(const LitVec & v1, const LitVec & v2) {
-      if (v1.size() < v2.size()) return true;
-      if (v1.size() > v2.size()) return false;
-      for (size_t i = 0; i < v1.size(); ++i) {
-        if (v1[i] < v2[i]) return true;
-        if (v2[i] < v1[i]) return false;
-      }
-      return false;
+    // Stores lits in the arena.
+    Span putLits(const LitVec & lits) {
+      Span sp = { stateLits.size(), lits.size() };
+      stateLits.insert(stateLits.end(), lits.begin(), lits.end());
+      return sp;
     }
-    static bool _LitVecEq(const LitVec & v1, const LitVec & v2) {
-      if (v1.size() != v2.size()) return false;
-      for (size_t i = 0; i < v1.size(); ++i)
-        if (v1[i] != v2[i]) return false;
-      return true;
+    void getLits(const Span & sp, LitVec & lits) const {
+      lits.assign(stateLits.begin() + sp.offset, 
+                  stateLits.begin() + sp.offset + sp.size);
+    }
+
+    // All cubes ever added as lemmas are interned in a single store
+    // shared by the frames, which refer to them by id.  cubeLevel
+    // records the frame a cube currently belongs to (0 if none); a
+    // frame's list may still mention ids that have since moved to a
+    // later frame until it is compacted.
+    CubeStore cubes;
+    vector<size_t> cubeLevel;
+    vector<bool> cubeMark;  // scratch for compact()
+    // Indexes exactly the cubes with a non-zero level.
+    SubsumptionIndex subsumption;
+
+    // Drops the cube from whichever frame it belongs to.  Its clause
+    // remains in the solvers, where it is harmless.
+    void removeCube(CubeId id) {
+      cubeLevel[id] = 0;
+      subsumption.erase(id);
     }
-    class LitVecComp {
-    public:
-      bool operator()(const LitVec & v1, const LitVec & v2) {
-        return _LitVecComp(v1, v2);
-      }
-    };
-    typedef set<LitVec, LitVecComp> CubeSet;
 
     // A proof obligation.
     struct Obligation {
@@ -320,7 +531,7 @@ namespace IC3 {
     };
     class ObligationComp {
     public:
-      bool operator()(const Obligation & o1, const Obligation & o2) {
+      bool operator()(const Obligation & o1, const Obligation & o2) const {
         if (o1.level < o2.level) return true;  // prefer lower levels (required)
         if (o1.level > o2.level) return false;
         if (o1.depth < o2.depth) return true;  // prefer shallower (heuristic)
@@ -329,18 +540,79 @@ namespace IC3 {
         return false;
       }
     };
-    typedef set<Obligation, ObligationComp> PriorityQueue;
+    // A binary heap of obligations whose top is the least according
+    // to ObligationComp, which is a total order, so that obligations
+    // are handled in the same order as from a sorted set.  Its storage
+    // is reused from one strengthen() iteration to the next.
+    class PriorityQueue {
+    public:
+      bool empty() const { return heap.empty(); }
+      const Obligation & top() const { return heap.front(); }
+      void push(const Obligation & obl) {
+        heap.push_back(obl);
+        push_heap(heap.begin(), heap.end(), after);
+      }
+      void pop() {
+        pop_heap(heap.begin(), heap.end(), after);
+        heap.pop_back();
+      }
+      void clear() { heap.clear(); }
+    private:
+      struct After {
+        bool operator()(const Obligation & o1, const Obligation & o2) const {
+          return ObligationComp()(o2, o1);
+        }
+      } after;
+      vector<Obligation> heap;
+    };
+    PriorityQueue obls;
 
     // For IC3's overall frame structure.
     struct Frame {
-      size_t k;             // steps from initial state
-      CubeSet borderCubes;  // additional cubes in this and previous frames
+      size_t k;               // steps from initial state
+      CubeIdVec borderCubes;  // additional cubes in this and previous frames
       Minisat::Solver * consecution;
+      Minisat::Lit act;       // if oneSolver: guards borderCubes' clauses
+      // for recycling (see recycle()): the solver's variables when
+      // built, then the activation variables released and the lemma
+      // clauses added since
+      int baseVars;
+      size_t released, lemmas;
     };
     vector<Frame> frames;
 
+    // If set, all frames share one solver, which holds the TR once.
+    // The clauses of frame i's lemmas are guarded by frames[i].act,
+    // and the initial condition by frames[0].act, so that frame i is
+    // selected by assuming the activation literals of frames i and up
+    // (see frameAssumps()).  Otherwise, each frame has a solver of its
+    // own.
+    bool oneSolver;
+
     Minisat::Solver * lifts;
     Minisat::Lit notInvConstraints;
+    int liftsBaseVars;
+    size_t liftsReleased;
+
+    // (Re)builds the lifting solver.
+    void buildLifts() {
+      lifts = model.newSolver();
+      // don't assert primed invariant constraints
+      model.loadTransitionRelation(*lifts, false);
+      // assert notInvConstraints (in stateOf) when lifting
+      notInvConstraints = Minisat::mkLit(lifts->newVar());
+      Minisat::vec<Minisat::Lit> cls;
+      cls.push(~notInvConstraints);
+      for (LitVec::const_iterator i = model.invariantConstraints().begin();
+           i != model.invariantConstraints().end(); ++i)
+        cls.push(model.primeLit(~*i));
+      lifts->addClause_(cls);
+      liftsBaseVars = lifts->nVars();
+      liftsReleased = 0;
+    }
+    // If set, stateOf() first tries to lift by ternary simulation,
+    // falling back to lifts.
+    TernarySim * tsim;
 
     // Push a new Frame.
     void extend() {
@@ -348,14 +620,50 @@ namespace IC3 {
         frames.resize(frames.size()+1);
         Frame & fr = frames.back();
         fr.k = frames.size()-1;
-        fr.consecution = model.newSolver();
-        if (random) {
-          fr.consecution->random_seed = rand();
-          fr.consecution->rnd_init_act = true;
+        if (oneSolver && fr.k > 0) {
+          fr.consecution = frames[0].consecution;
+          fr.act = Minisat::mkLit(fr.consecution->newVar());
         }
-        if (fr.k == 0) model.loadInitialCondition(*fr.consecution);
-        model.loadTransitionRelation(*fr.consecution);
+        else
+          buildFrame(fr);
+      }
+    }
+
+    // Gives the frame a new solver loaded with the TR, the initial
+    // condition (if needed), and the background, but no lemmas.
+    void buildFrame(Frame & fr) {
+      fr.consecution = model.newSolver();
+      if (random) {
+        fr.consecution->random_seed = rand_r(&seed);
+        fr.consecution->rnd_init_act = true;
+      }
+      if (fr.k == 0 && !oneSolver) 
+        model.loadInitialCondition(*fr.consecution);
+      model.loadTransitionRelation(*fr.consecution);
+      if (oneSolver) {
+        fr.act = Minisat::mkLit(fr.consecution->newVar());
+        model.loadInitialCondition(*fr.consecution, fr.act);
       }
+      if (background)
+        for (vector<LitVec>::const_iterator i = background->begin();
+             i != background->end(); ++i) {
+          MSLitVec cls;
+          for (LitVec::const_iterator j = i->begin(); j != i->end(); ++j)
+            cls.push(~*j);
+          fr.consecution->addClause_(cls);
+        }
+      fr.baseVars = fr.consecution->nVars();
+      fr.released = fr.lemmas = 0;
+    }
+
+    // Frame i's solver and its recycling counters.
+    Frame & solverFrame(size_t i) { return frames[oneSolver ? 0 : i]; }
+
+    // Retires the activation literal of a query on frame i's solver.
+    void release(size_t i, Minisat::Lit act) {
+      Frame & fr = solverFrame(i);
+      fr.consecution->releaseVar(act);
+      ++fr.released;
     }
 
     // Structure and methods for imposing priorities on literals
@@ -363,39 +671,75 @@ namespace IC3 {
     // literal first) and assumptions to Minisat.  The implemented
     // ordering prefers to keep literals that appear frequently in
     // addCube() calls.
+    //
+    // Counts are kept VSIDS-style: decaying all counts by a factor is
+    // done by growing the amount that count() adds by its inverse,
+    // with an occasional rescale, so that both are O(cube) rather
+    // than O(#vars).  Non-negative doubles order as their bit
+    // patterns do, so literals are sorted by integer keys.
     struct HeuristicLitOrder {
-      HeuristicLitOrder() : _mini(1<<20) {}
-      vector<float> counts;
-      size_t _mini;
+      HeuristicLitOrder() : inc(1) {}
+      vector<double> counts;
+      double inc;
       void count(const LitVec & cube) {
         assert (!cube.empty());
         // assumes cube is ordered
         size_t sz = (size_t) Minisat::toInt(Minisat::var(cube.back()));
         if (sz >= counts.size()) counts.resize(sz+1);
-        _mini = (size_t) Minisat::toInt(Minisat::var(cube[0]));
         for (LitVec::const_iterator i = cube.begin(); i != cube.end(); ++i)
-          counts[(size_t) Minisat::toInt(Minisat::var(*i))] += 1;
+          counts[(size_t) Minisat::toInt(Minisat::var(*i))] += inc;
       }
       void decay() {
-        for (size_t i = _mini; i < counts.size(); ++i)
-          counts[i] *= 0.99;
+        inc /= 0.99;
+        if (inc > 1e100) {
+          for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] *= 1e-100;
+          inc *= 1e-100;
+        }
+      }
+      // Orders (unprimed) literals by count; never-counted variables
+      // come first.
+      uint64_t key(Minisat::Lit lit) const {
+        size_t i = (size_t) Minisat::toInt(Minisat::var(lit));
+        if (i >= counts.size()) return 0;
+        uint64_t bits;
+        memcpy(&bits, &counts[i], sizeof bits);
+        return bits + 1;
       }
     } litOrder;
 
-    struct SlimLitOrder {
-      HeuristicLitOrder *heuristicLitOrder;
-
-      SlimLitOrder() {}
-
-      bool operator()(const Minisat::Lit & l1, const Minisat::Lit & l2) const {
-        // l1, l2 must be unprimed
-        size_t i2 = (size_t) Minisat::toInt(Minisat::var(l2));
-        if (i2 >= heuristicLitOrder->counts.size()) return false;
-        size_t i1 = (size_t) Minisat::toInt(Minisat::var(l1));
-        if (i1 >= heuristicLitOrder->counts.size()) return true;
-        return (heuristicLitOrder->counts[i1] < heuristicLitOrder->counts[i2]);
+    // Stable-sorts [begin, end) by increasing key.  It may be called
+    // from several threads at once, so each thread has its own
+    // scratch.  Most cubes are short enough for insertion sort; longer
+    // ranges are sorted by (key, position), which is stable without
+    // stable_sort's temporary buffer.
+    void sortByKey(Minisat::Lit * begin, Minisat::Lit * end) const {
+      struct Keyed {
+        uint64_t key;
+        size_t pos;
+        Minisat::Lit lit;
+        bool operator<(const Keyed & b) const {
+          return key < b.key || (key == b.key && pos < b.pos);
+        }
+      };
+      static thread_local vector<Keyed> keyed;
+      size_t n = end - begin;
+      keyed.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        Keyed kd = { litOrder.key(begin[i]), i, begin[i] };
+        if (n > 16) {
+          keyed[i] = kd;
+          continue;
+        }
+        size_t j = i;
+        for (; j > 0 && kd.key < keyed[j-1].key; --j)
+          keyed[j] = keyed[j-1];
+        keyed[j] = kd;
       }
-    } slimLitOrder;
+      if (n > 16) sort(keyed.begin(), keyed.end());
+      for (size_t i = 0; i < n; ++i)
+        begin[i] = keyed[i].lit;
+    }
 
     float numLits, numUpdates;
     void updateLitOrder(const LitVec & cube, size_t level) {
@@ -407,85 +751,148 @@ namespace IC3 {
 
     // order according to preference
     void orderCube(LitVec & cube) {
-      stable_sort(cube.begin(), cube.end(), slimLitOrder);
+      if (!cube.empty()) sortByKey(&cube[0], &cube[0] + cube.size());
     }
 
     typedef Minisat::vec<Minisat::Lit> MSLitVec;
 
+    // Appends the assumptions that select frame i.
+    void frameAssumps(size_t i, MSLitVec & assumps) const {
+      if (!oneSolver) return;
+      for (size_t j = i; j < frames.size(); ++j)
+        assumps.push(frames[j].act);
+    }
+
     // Orders assumptions for Minisat.
     void orderAssumps(MSLitVec & cube, bool rev, int start = 0) {
-      stable_sort(cube + start, cube + cube.size(), slimLitOrder);
+      sortByKey(cube + start, cube + cube.size());
       if (rev) reverse(cube + start, cube + cube.size());
     }
 
+    // Extracts primary inputs, primed primary inputs, and latches
+    // from slv's satisfying assignment.  Only reads slv, so workers
+    // can call it on their replicas.
+    void modelState(const Minisat::Solver & slv, LitVec & inputs,
+                    LitVec & nextInputs, LitVec & latches) const
+    {
+      inputs.clear();
+      nextInputs.clear();
+      latches.clear();
+      for (VarVec::const_iterator i = model.beginInputs(); 
+           i != model.endInputs(); ++i) {
+        Minisat::lbool val = slv.modelValue(i->var());
+        if (val != Minisat::l_Undef)
+          inputs.push_back(i->lit(val == Minisat::l_False));  // record full inputs
+        Minisat::lbool pval = slv.modelValue(model.primeVar(*i).var());
+        if (pval != Minisat::l_Undef)
+          nextInputs.push_back(i->lit(pval == Minisat::l_False));
+      }
+      for (VarVec::const_iterator i = model.beginLatches(); 
+           i != model.endLatches(); ++i) {
+        Minisat::lbool val = slv.modelValue(i->var());
+        if (val != Minisat::l_Undef)
+          latches.push_back(i->lit(val == Minisat::l_False));
+      }
+    }
+
     // Assumes that last call to fr.consecution->solve() was
     // satisfiable.  Extracts state(s) cube from satisfying
     // assignment.
     size_t stateOf(Frame & fr, size_t succ = 0) {
-      // create state
-      size_t st = newState();
-      state(st).successor = succ;
-      MSLitVec assumps;
-      assumps.capacity(1 + 2 * (model.endInputs()-model.beginInputs())
-                       + (model.endLatches()-model.beginLatches()));
-      Minisat::Lit act = Minisat::mkLit(lifts->newVar());  // activation literal
-      assumps.push(act);
-      Minisat::vec<Minisat::Lit> cls;
-      cls.push(~act);
-      cls.push(notInvConstraints);  // successor must satisfy inv. constraint
-      if (succ == 0)
-        cls.push(~model.primedError());
-      else
-        for (LitVec::const_iterator i = state(succ).latches.begin(); 
-             i != state(succ).latches.end(); ++i)
-          cls.push(model.primeLit(~*i));
-      lifts->addClause_(cls);
-      // extract and assert primary inputs
-      for (VarVec::const_iterator i = model.beginInputs(); 
-           i != model.endInputs(); ++i) {
-        Minisat::lbool val = fr.consecution->modelValue(i->var());
-        if (val != Minisat::l_Undef) {
-          Minisat::Lit pi = i->lit(val == Minisat::l_False);
-          state(st).inputs.push_back(pi);  // record full inputs
-          assumps.push(pi);
+      modelState(*fr.consecution, liftInputs, liftNextInputs, liftLatches);
+      return liftState(succ);
+    }
+
+    // As stateOf(), for an assignment that modelState() extracted
+    // earlier.
+    size_t stateOf(const LitVec & inputs, const LitVec & nextInputs,
+                   const LitVec & latches, size_t succ = 0)
+    {
+      liftInputs = inputs;
+      liftNextInputs = nextInputs;
+      liftLatches = latches;
+      return liftState(succ);
+    }
+
+    // Lifts the assignment in liftInputs, liftNextInputs, and
+    // liftLatches to a state cube that leads to succ (or to a
+    // violation of the property if succ is 0).
+    size_t liftState(size_t succ) {
+      Profile::Scope scope(prof, PhLift);  // stats
+      LitVec & inputs = liftInputs, & nextInputs = liftNextInputs;
+      LitVec & latches = liftLatches, & lifted = liftLifted;
+      lifted.clear();
+      if (succ) getLits(state(succ).latches, liftSucc);
+      bool simLifted = false;
+      if (tsim) {
+        // try to lift by simulation, dropping latches in the order in
+        // which mic drops literals
+        liftOrder = latches;
+        orderCube(liftOrder);
+        startTimer();  // stats
+        simLifted = tsim->lift(inputs, nextInputs, liftOrder,
+                               succ ? &liftSucc : NULL, lifted);
+        endTimer(simTime);
+        if (simLifted) {
+          sort(lifted.begin(), lifted.end());
+          ++nSimLifts;  // stats
         }
       }
-      // some properties include inputs, so assert primed inputs after        
-      for (VarVec::const_iterator i = model.beginInputs(); 
-           i != model.endInputs(); ++i) {
-        Minisat::lbool pval = 
-          fr.consecution->modelValue(model.primeVar(*i).var());
-        if (pval != Minisat::l_Undef)
-          assumps.push(model.primeLit(i->lit(pval == Minisat::l_False)));
+      if (!simLifted) {
+        MSLitVec assumps;
+        assumps.capacity(1 + inputs.size() + nextInputs.size()
+                         + latches.size());
+        Minisat::Lit act = Minisat::mkLit(lifts->newVar());  // activation literal
+        assumps.push(act);
+        Minisat::vec<Minisat::Lit> cls;
+        cls.push(~act);
+        cls.push(notInvConstraints);  // successor must satisfy inv. constraint
+        if (succ == 0)
+          cls.push(~model.primedError());
+        else
+          for (LitVec::const_iterator i = liftSucc.begin(); 
+               i != liftSucc.end(); ++i)
+            cls.push(model.primeLit(~*i));
+        lifts->addClause_(cls);
+        // assert primary inputs
+        for (LitVec::const_iterator i = inputs.begin(); 
+             i != inputs.end(); ++i)
+          assumps.push(*i);
+        // some properties include inputs, so assert primed inputs after        
+        for (LitVec::const_iterator i = nextInputs.begin(); 
+             i != nextInputs.end(); ++i)
+          assumps.push(model.primeLit(*i));
+        int sz = assumps.size();
+        // assert latches
+        for (LitVec::const_iterator i = latches.begin(); 
+             i != latches.end(); ++i)
+          assumps.push(*i);
+        orderAssumps(assumps, false, sz);  // empirically found to be best choice
+        // State s, inputs i, transition relation T, successor t:
+        //   s & i & T & ~t' is unsat
+        // Core assumptions reveal a lifting of s.
+        startQuery();  // stats
+        bool rv = lifts->solve(assumps);
+        endQuery();
+        assert (!rv);
+        // obtain lifted latch set from unsat core
+        for (LitVec::const_iterator i = latches.begin(); i != latches.end(); ++i)
+          if (lifts->conflict.has(~*i))
+            lifted.push_back(*i);  // record lifted latches
+        // deactivate negation of successor
+        lifts->releaseVar(~act);
+        ++liftsReleased;
       }
-      int sz = assumps.size();
-      // extract and assert latches
-      LitVec latches;
-      for (VarVec::const_iterator i = model.beginLatches(); 
-           i != model.endLatches(); ++i) {
-        Minisat::lbool val = fr.consecution->modelValue(i->var());
-        if (val != Minisat::l_Undef) {
-          Minisat::Lit la = i->lit(val == Minisat::l_False);
-          latches.push_back(la);
-          assumps.push(la);
-        }
-      }
-      orderAssumps(assumps, false, sz);  // empirically found to be best choice
-      // State s, inputs i, transition relation T, successor t:
-      //   s & i & T & ~t' is unsat
-      // Core assumptions reveal a lifting of s.
-      ++nQuery; startTimer();  // stats
-      bool rv = lifts->solve(assumps);
-      endTimer(satTime);
-      assert (!rv);
-      // obtain lifted latch set from unsat core
-      for (LitVec::const_iterator i = latches.begin(); i != latches.end(); ++i)
-        if (lifts->conflict.has(~*i))
-          state(st).latches.push_back(*i);  // record lifted latches
-      // deactivate negation of successor
-      lifts->releaseVar(~act);
+      // create state
+      size_t st = newState();
+      state(st).successor = succ;
+      state(st).inputs = putLits(inputs);
+      state(st).latches = putLits(lifted);
       return st;
     }
+    // scratch for stateOf()
+    LitVec liftInputs, liftNextInputs, liftLatches, liftLifted, liftSucc,
+      liftOrder;
 
     // Checks if cube contains any initial states.
     bool initiation(const LitVec & latches) {
@@ -501,43 +908,27 @@ namespace IC3 {
                      bool orderedCore = false)
     {
       Frame & fr = frames[fi];
-      MSLitVec assumps, cls;
-      assumps.capacity(1 + latches.size());
-      cls.capacity(1 + latches.size());
-      Minisat::Lit act = Minisat::mkLit(fr.consecution->newVar());
-      assumps.push(act);
-      cls.push(~act);
-      for (LitVec::const_iterator i = latches.begin(); 
-           i != latches.end(); ++i) {
-        cls.push(~*i);
-        assumps.push(*i);  // push unprimed...
-      }
-      // ... order... (empirically found to best choice)
-      if (pred) orderAssumps(assumps, false, 1);
-      else orderAssumps(assumps, orderedCore, 1);
-      // ... now prime
-      for (int i = 1; i < assumps.size(); ++i)
-        assumps[i] = model.primeLit(assumps[i]);
-      fr.consecution->addClause_(cls);
+      MSLitVec assumps;
+      startQuery();  // stats
       // F_fi & ~latches & T & latches'
-      ++nQuery; startTimer();  // stats
-      bool rv = fr.consecution->solve(assumps);
-      endTimer(satTime);
+      bool rv = relativeInduction(fi, latches, assumps,
+                                  pred ? false : orderedCore);
+      endQuery();
       if (rv) {
         // fails: extract predecessor(s)
         if (pred) *pred = stateOf(fr, succ);
-        fr.consecution->releaseVar(~act);
+        release(fi, ~assumps[0]);
         return false;
       }
       // succeeds
       if (core) {
         if (pred && orderedCore) {
           // redo with correctly ordered assumps
-          reverse(assumps+1, assumps+assumps.size());
-          ++nQuery; startTimer();  // stats
+          reverse(assumps+1, assumps+1+latches.size());
+          startQuery();  // stats
           rv = fr.consecution->solve(assumps);
           assert (!rv);
-          endTimer(satTime);
+          endQuery();
         }
         for (LitVec::const_iterator i = latches.begin(); 
              i != latches.end(); ++i)
@@ -546,26 +937,74 @@ namespace IC3 {
         if (!initiation(*core))
           *core = latches;
       }
-      fr.consecution->releaseVar(~act);
+      release(fi, ~assumps[0]);
       return true;
     }
 
+    // Adds ~latches to frame fi's solver under a fresh activation
+    // literal and checks it relative to frame fi: returns whether
+    // F_fi & ~latches & T & latches' is satisfiable.  The assumptions,
+    // headed by the activation literal and followed by the primed
+    // latches, are left in assumps; the caller releases ~assumps[0]
+    // when done with the result.  Only frame fi's solver is modified,
+    // so frames with distinct solvers can be queried from distinct
+    // threads.
+    bool relativeInduction(size_t fi, const LitVec & latches,
+                           MSLitVec & assumps, bool rev)
+    {
+      Minisat::Solver & slv = *frames[fi].consecution;
+      MSLitVec cls;
+      assumps.capacity(1 + latches.size()
+                       + (oneSolver ? frames.size() - fi : 0));
+      cls.capacity(1 + latches.size());
+      Minisat::Lit act = Minisat::mkLit(slv.newVar());
+      assumps.push(act);
+      cls.push(~act);
+      for (LitVec::const_iterator i = latches.begin(); 
+           i != latches.end(); ++i) {
+        cls.push(~*i);
+        assumps.push(*i);  // push unprimed...
+      }
+      // ... order... (empirically found to best choice)
+      orderAssumps(assumps, rev, 1);
+      // ... now prime
+      for (int i = 1; i < assumps.size(); ++i)
+        assumps[i] = model.primeLit(assumps[i]);
+      frameAssumps(fi, assumps);
+      slv.addClause_(cls);
+      return slv.solve(assumps);
+    }
+
     size_t maxDepth, maxCTGs, maxJoins, micAttempts;
 
+    // A failed speculative drop of lit (see dropParallel()): the
+    // assignment of the replica's model, which is a predecessor of
+    // the cube without lit, yet to be lifted.
+    struct SpecFail {
+      Minisat::Lit lit;
+      LitVec inputs, nextInputs, latches;
+    };
+
     // Based on
     //
     //   Zyad Hassan, Aaron R. Bradley, and Fabio Somenzi, "Better
     //   Generalization in IC3," (submitted May 2013)
     //
     // Improves upon "down" from the original paper (and the FMCAD'07
-    // paper) by handling CTGs.
-    bool ctgDown(size_t level, LitVec & cube, size_t keepTo, size_t recDepth) {
+    // paper) by handling CTGs.  If spec is given, it was found for
+    // cube under the current frames, so the first consecution query
+    // is known to fail and is skipped.
+    bool ctgDown(size_t level, LitVec & cube, size_t keepTo, size_t recDepth,
+                 const SpecFail * spec = NULL)
+    {
+      Profile::Scope scope(prof, PhCtg);  // stats
       size_t ctgs = 0, joins = 0;
       while (true) {
         // induction check
         if (!initiation(cube))
           return false;
         if (recDepth > maxDepth) {
+          if (spec) return false;
           // quick check if recursion depth is exceeded
           LitVec core;
           bool rv = consecution(level, cube, 0, &core, NULL, true);
@@ -578,10 +1017,15 @@ namespace IC3 {
         // prepare to obtain CTG
         size_t cubeState = newState();
         state(cubeState).successor = 0;
-        state(cubeState).latches = cube;
+        state(cubeState).latches = putLits(cube);
         size_t ctg;
         LitVec core;
-        if (consecution(level, cube, cubeState, &core, &ctg, true)) {
+        if (spec) {
+          ctg = stateOf(spec->inputs, spec->nextInputs, spec->latches,
+                        cubeState);
+          spec = NULL;
+        }
+        else if (consecution(level, cube, cubeState, &core, &ctg, true)) {
           if (core.size() < cube.size()) {
             ++nCoreReduced;  // stats
             cube = core;
@@ -591,10 +1035,11 @@ namespace IC3 {
           return true;
         }
         // not inductive, address interfering CTG
-        LitVec ctgCore;
+        LitVec ctgLatches, ctgCore;
+        getLits(state(ctg).latches, ctgLatches);
         bool ret = false;
-        if (ctgs < maxCTGs && level > 1 && initiation(state(ctg).latches)
-            && consecution(level-1, state(ctg).latches, cubeState, &ctgCore)) {
+        if (ctgs < maxCTGs && level > 1 && initiation(ctgLatches)
+            && consecution(level-1, ctgLatches, cubeState, &ctgCore)) {
           // CTG is inductive relative to level-1; push forward and generalize
           ++nCTG;  // stats
           ++ctgs;
@@ -610,8 +1055,7 @@ namespace IC3 {
           ++joins;
           LitVec tmp;
           for (size_t i = 0; i < cube.size(); ++i)
-            if (binary_search(state(ctg).latches.begin(), 
-                              state(ctg).latches.end(), cube[i]))
+            if (binary_search(ctgLatches.begin(), ctgLatches.end(), cube[i]))
               tmp.push_back(cube[i]);
             else if (i < keepTo) {
               // previously failed when this literal was dropped
@@ -635,14 +1079,28 @@ namespace IC3 {
     // ctgDown, it's not quite a MIC anymore, but what's returned is
     // inductive relative to the possibly modifed level.
     void mic(size_t level, LitVec & cube, size_t recDepth) {
+      Profile::Scope scope(prof, PhMic);  // stats
       ++nmic;  // stats
+      orderCube(cube);
+      if (chunked) dropChunks(level, cube);
+      vector<SpecFail> specFails;
+      if (micThreads > 1) dropParallel(level, cube, specFails);
+      size_t stamp = lemmaStamp;
       // try dropping each literal in turn
       size_t attempts = micAttempts;
-      orderCube(cube);
-      for (size_t i = 0; i < cube.size();) {
+      for (size_t i = 0; i < cube.size() && !stopped();) {
         LitVec cp(cube.begin(), cube.begin() + i);
         cp.insert(cp.end(), cube.begin() + i+1, cube.end());
-        if (ctgDown(level, cp, i, recDepth)) {
+        // a speculative failure holds until the cube or the frames
+        // change
+        if (lemmaStamp != stamp) specFails.clear();
+        const SpecFail * spec = NULL;
+        for (size_t j = 0; j < specFails.size() && !spec; ++j)
+          if (specFails[j].lit == cube[i]) {
+            spec = &specFails[j];
+            ++nSpecReused;  // stats
+          }
+        if (ctgDown(level, cp, i, recDepth, spec)) {
           // maintain original order
           LitSet lits(cp.begin(), cp.end());
           LitVec tmp;
@@ -650,6 +1108,7 @@ namespace IC3 {
             if (lits.find(*j) != lits.end())
               tmp.push_back(*j);
           cube.swap(tmp);
+          specFails.clear();
           // reset attempts
           attempts = micAttempts;
         }
@@ -668,6 +1127,295 @@ namespace IC3 {
       }
     }
 
+    // If set, mic first drops literals in chunks (see dropChunks()).
+    bool chunked;
+
+    // Tries to drop chunks of cube's literals with one plain
+    // consecution query each, sweeping the cube with chunks of half
+    // its size, then a quarter, and so on down to two literals, which
+    // leaves single literals to mic.  A successful query's core
+    // drops, besides the chunk, every other literal that it shows to
+    // be irrelevant.  A chunk that fails is skipped rather than split
+    // at once, as QuickXplain would; its literals get another chance
+    // in the next pass, with chunks of half the size.  Keeps cube's
+    // (preference) order.
+    void dropChunks(size_t level, LitVec & cube) {
+      LitVec cp, core;
+      for (size_t chunk = cube.size() / 2; chunk >= 2; chunk /= 2)
+        for (size_t i = 0; i + chunk <= cube.size() && !stopped();) {
+          cp.assign(cube.begin(), cube.begin() + i);
+          cp.insert(cp.end(), cube.begin() + i + chunk, cube.end());
+          core.clear();
+          ++nChunkQueries;  // stats
+          if (!initiation(cp) || !consecution(level, cp, 0, &core)) {
+            i += chunk;  // keep these for now
+            continue;
+          }
+          sort(core.begin(), core.end());
+          size_t n = 0;
+          for (size_t j = 0; j < cube.size(); ++j)
+            if (binary_search(core.begin(), core.end(), cube[j]))
+              cube[n++] = cube[j];
+          nChunkDropped += cube.size() - n;  // stats
+          cube.resize(n);
+        }
+    }
+
+    // Worker threads for speculative literal dropping (see
+    // dropParallel()), if more than one.
+    unsigned micThreads;
+
+    // A worker's private copy of the frames: one solver that holds
+    // the TR once and each lemma under its level's activation
+    // literal, as with oneSolver.  It is built from the lemmas of the
+    // frames and then brought up to date by replaying lemmaLog, which
+    // records each lemma clause added to the frames while there are
+    // replicas.  The prefix of the log that all replicas have is
+    // dropped (see trimLemmaLog()).
+    struct Replica {
+      Minisat::Solver * slv;
+      LitVec acts;    // by level; acts[0] guards the initial condition
+      size_t synced;  // prefix of lemmaLog that slv has
+      // for recycling, as for Frame
+      int baseVars;
+      size_t released, lemmas;
+    };
+    vector<Replica> replicas;
+    vector< pair<size_t, CubeId> > lemmaLog;  // (level, lemma)
+
+    // The workers of dropParallel(), one per replica, which live as
+    // long as the replicas.  A batch of attempts is started by
+    // advancing dropBatch; each worker then syncs its replica, makes
+    // its attempt, if it has one, and counts down dropPending.
+    vector<std::thread> dropWorkers;
+    std::mutex dropMutex;
+    std::condition_variable dropStart, dropDone;
+    size_t dropBatch, dropPending;
+    bool dropQuit;
+    // the current batch: attempt t drops a literal to get dropCands[t]
+    size_t dropLevel, dropCount;
+    vector<LitVec> dropCands, dropCores;
+    vector<char> dropTried, dropOk;
+    vector<SpecFail> dropFails;  // dropFails[t] is set if attempt t fails
+    size_t lemmaStamp;  // counts lemmas added to the frames
+
+    // Builds a replica holding the lemmas currently in the frames.
+    void buildReplica(Replica & r) {
+      r.slv = model.newSolver();
+      if (random) {
+        r.slv->random_seed = rand_r(&seed);
+        r.slv->rnd_init_act = true;
+      }
+      model.loadTransitionRelation(*r.slv);
+      r.acts.assign(1, Minisat::mkLit(r.slv->newVar()));
+      model.loadInitialCondition(*r.slv, r.acts[0]);
+      if (background)
+        for (vector<LitVec>::const_iterator i = background->begin();
+             i != background->end(); ++i) {
+          MSLitVec cls;
+          for (LitVec::const_iterator j = i->begin(); j != i->end(); ++j)
+            cls.push(~*j);
+          r.slv->addClause_(cls);
+        }
+      while (r.acts.size() < frames.size())
+        r.acts.push_back(Minisat::mkLit(r.slv->newVar()));
+      r.baseVars = r.slv->nVars();
+      r.released = r.lemmas = 0;
+      for (size_t i = 1; i < frames.size(); ++i)
+        for (CubeIdVec::const_iterator j = frames[i].borderCubes.begin();
+             j != frames[i].borderCubes.end(); ++j)
+          if (cubeLevel[*j] == i)
+            replicaLemma(r, i, *j);
+      r.synced = lemmaLog.size();
+    }
+
+    void replicaLemma(Replica & r, size_t level, CubeId id) const {
+      MSLitVec cls;
+      for (const Minisat::Lit * l = cubes.begin(id); l != cubes.end(id); ++l)
+        cls.push(~*l);
+      cls.push(~r.acts[level]);
+      r.slv->addClause_(cls);
+      ++r.lemmas;
+    }
+
+    // Runs on r's worker thread: only r is modified.
+    void syncReplica(Replica & r) const {
+      while (r.acts.size() < frames.size())
+        r.acts.push_back(Minisat::mkLit(r.slv->newVar()));
+      for (; r.synced < lemmaLog.size(); ++r.synced)
+        replicaLemma(r, lemmaLog[r.synced].first, lemmaLog[r.synced].second);
+    }
+
+    void trimLemmaLog() {
+      size_t n = lemmaLog.size();
+      for (size_t t = 0; t < replicas.size(); ++t)
+        n = min(n, replicas[t].synced);
+      if (!n) return;
+      lemmaLog.erase(lemmaLog.begin(), lemmaLog.begin() + n);
+      for (size_t t = 0; t < replicas.size(); ++t)
+        replicas[t].synced -= n;
+    }
+
+    // consecution() on a replica, without initiation check of the
+    // core.  Runs on r's worker thread.
+    bool replicaConsecution(Replica & r, size_t level, const LitVec & latches,
+                            LitVec & core)
+    {
+      MSLitVec assumps, cls;
+      Minisat::Lit act = Minisat::mkLit(r.slv->newVar());
+      assumps.push(act);
+      cls.push(~act);
+      for (LitVec::const_iterator i = latches.begin(); 
+           i != latches.end(); ++i) {
+        cls.push(~*i);
+        assumps.push(*i);
+      }
+      orderAssumps(assumps, false, 1);
+      for (int i = 1; i < assumps.size(); ++i)
+        assumps[i] = model.primeLit(assumps[i]);
+      for (size_t j = level; j < frames.size(); ++j)
+        assumps.push(r.acts[j]);
+      r.slv->addClause_(cls);
+      bool rv = r.slv->solve(assumps);
+      if (!rv)
+        for (LitVec::const_iterator i = latches.begin(); 
+             i != latches.end(); ++i)
+          if (r.slv->conflict.has(~model.primeLit(*i)))
+            core.push_back(*i);
+      r.slv->releaseVar(~act);
+      ++r.released;
+      return !rv;
+    }
+
+    void dropWorker(size_t t) {
+      size_t seen = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(dropMutex);
+          dropStart.wait(lock, [&]() { return dropQuit || dropBatch != seen; });
+          if (dropQuit) return;
+          seen = dropBatch;
+        }
+        syncReplica(replicas[t]);
+        if (t < dropCount && dropTried[t]) {
+          Replica & r = replicas[t];
+          dropOk[t] = replicaConsecution(r, dropLevel, dropCands[t],
+                                         dropCores[t]);
+          if (!dropOk[t]) {
+            SpecFail & f = dropFails[t];
+            modelState(*r.slv, f.inputs, f.nextInputs, f.latches);
+          }
+        }
+        std::lock_guard<std::mutex> lock(dropMutex);
+        if (--dropPending == 0) dropDone.notify_one();
+      }
+    }
+
+    void startDropWorkers() {
+      replicas.resize(micThreads);
+      for (size_t t = 0; t < replicas.size(); ++t)
+        buildReplica(replicas[t]);
+      dropCands.resize(micThreads);
+      dropCores.resize(micThreads);
+      dropTried.resize(micThreads);
+      dropOk.resize(micThreads);
+      dropFails.resize(micThreads);
+      dropQuit = false;
+      for (size_t t = 0; t < replicas.size(); ++t)
+        dropWorkers.push_back(std::thread(&IC3::dropWorker, this, t));
+    }
+
+    // Stops the workers and frees their replicas.
+    void stopDropWorkers() {
+      {
+        std::lock_guard<std::mutex> lock(dropMutex);
+        dropQuit = true;
+      }
+      dropStart.notify_all();
+      for (size_t t = 0; t < dropWorkers.size(); ++t)
+        dropWorkers[t].join();
+      dropWorkers.clear();
+      for (size_t t = 0; t < replicas.size(); ++t)
+        delete replicas[t].slv;
+      vector<Replica>().swap(replicas);
+      vector< pair<size_t, CubeId> >().swap(lemmaLog);
+    }
+
+    // Runs a batch of attempts on the workers.
+    void runDropBatch() {
+      std::unique_lock<std::mutex> lock(dropMutex);
+      ++dropBatch;
+      dropPending = replicas.size();
+      dropStart.notify_all();
+      dropDone.wait(lock, [&]() { return dropPending == 0; });
+    }
+
+    // Speculatively tries to drop the next micThreads literals of
+    // cube at once, one per worker, each with one plain consecution
+    // query on the worker's replica.  The earliest success in cube's
+    // order is committed, along with its core, exactly as if the
+    // attempts had been made one after the other; so the result does
+    // not depend on scheduling.  As in mic, the sweep ends after
+    // micAttempts failures in a row.  Literals that fail are kept for
+    // the ctgDown() loop of mic, and the failures since the last
+    // success are left in fails: the predecessors they found spare
+    // ctgDown() its first query.
+    void dropParallel(size_t level, LitVec & cube, vector<SpecFail> & fails)
+    {
+      if (replicas.empty()) startDropWorkers();
+      dropLevel = level;
+      size_t attempts = micAttempts;
+      for (size_t i = 0; i < cube.size() && !stopped();) {
+        size_t n = min((size_t) micThreads, cube.size() - i);
+        for (size_t t = 0; t < n; ++t) {
+          dropCands[t].assign(cube.begin(), cube.begin() + i + t);
+          dropCands[t].insert(dropCands[t].end(), 
+                              cube.begin() + i + t + 1, cube.end());
+          dropCores[t].clear();
+          dropTried[t] = initiation(dropCands[t]);
+          dropOk[t] = false;
+        }
+        dropCount = n;
+        startTimer();  // stats: counts the CPU time of all workers
+        runDropBatch();
+        endTimer(satTime);
+        // every replica has synced
+        trimLemmaLog();
+        size_t t = 0;
+        for (; t < n; ++t) {
+          if (dropTried[t]) ++nSpecQueries;  // stats
+          if (dropOk[t]) break;
+        }
+        if (t >= attempts || t == n) {
+          // the cube is unchanged, so the failures hold
+          for (size_t u = 0; u < t; ++u)
+            if (dropTried[u]) {
+              dropFails[u].lit = cube[i + u];
+              fails.push_back(SpecFail());
+              swap(fails.back(), dropFails[u]);
+            }
+          if (t >= attempts) break;
+          attempts -= n;
+          i += n;
+          continue;
+        }
+        fails.clear();
+        attempts = micAttempts;
+        LitVec & core = dropCores[t];
+        if (!initiation(core)) core = dropCands[t];
+        sort(core.begin(), core.end());
+        size_t m = 0, next = 0;
+        for (size_t j = 0; j < cube.size(); ++j)
+          if (binary_search(core.begin(), core.end(), cube[j])) {
+            if (j < i + t) ++next;
+            cube[m++] = cube[j];
+          }
+        nSpecDropped += cube.size() - m;  // stats
+        cube.resize(m);
+        i = next;
+      }
+    }
+
     // wrapper to start inductive generalization
     void mic(size_t level, LitVec & cube) {
       mic(level, cube, 1);
@@ -681,20 +1429,80 @@ namespace IC3 {
                  bool silent = false)
     {
       sort(cube.begin(), cube.end());
-      pair<CubeSet::iterator, bool> rv = frames[level].borderCubes.insert(cube);
-      if (!rv.second) return;
+      CubeId id = cubes.intern(cube);
+      if (id >= cubeLevel.size()) {
+        cubeLevel.resize(id+1, 0);
+        cubeMark.resize(id+1, false);
+      }
+      size_t prev = cubeLevel[id];
+      if (prev >= level) return;  // already in this or a later frame
+      // forward subsumption: is cube already blocked at level by a
+      // lemma at this or a later level?
+      subsumed.clear();
+      subsumption.subsets(id, subsumed);
+      for (CubeIdVec::const_iterator i = subsumed.begin(); 
+           i != subsumed.end(); ++i)
+        if (cubeLevel[*i] >= level) {
+          ++nFwdSubsumed;  // stats
+          if (prev) removeCube(id);
+          return;
+        }
+      if (!prev) subsumption.insert(id);
+      cubeLevel[id] = level;
+      ++lemmaStamp;
+      frames[level].borderCubes.push_back(id);
+      if (!silent) prof.lemma(level);  // stats
+      if (!replicas.empty()) lemmaLog.push_back(make_pair(level, id));
+      if (channel && publishing) channel->publish(worker, level, cube);
+      // backward subsumption: drop lemmas at this or earlier levels
+      // that the new one makes redundant
+      subsumed.clear();
+      subsumption.supersets(id, subsumed);
+      for (CubeIdVec::const_iterator i = subsumed.begin(); 
+           i != subsumed.end(); ++i)
+        if (cubeLevel[*i] <= level) {
+          ++nBwdSubsumed;  // stats
+          removeCube(*i);
+        }
       if (!silent && verbose > 1) 
         cout << level << ": " << stringOfLitVec(cube) << endl;
       earliest = min(earliest, level);
       MSLitVec cls;
-      cls.capacity(cube.size());
+      cls.capacity(cube.size() + 1);
       for (LitVec::const_iterator i = cube.begin(); i != cube.end(); ++i)
         cls.push(~*i);
-      for (size_t i = toAll ? 1 : level; i <= level; ++i)
-        frames[i].consecution->addClause(cls);
+      if (oneSolver) {
+        // one clause, active in frames up to level
+        cls.push(~frames[level].act);
+        frames[level].consecution->addClause(cls);
+        ++frames[0].lemmas;
+      }
+      else
+        // frames up to prev already have the clause
+        for (size_t i = toAll ? max(prev+1, (size_t) 1) : level; i <= level; ++i) {
+          frames[i].consecution->addClause(cls);
+          ++frames[i].lemmas;
+        }
       if (toAll && !silent) updateLitOrder(cube, level);
     }
 
+    CubeIdVec subsumed;  // scratch for addCube()
+
+    // Removes from frame i's list the ids of cubes that have moved to
+    // another frame, as well as duplicates.
+    void compact(size_t i) {
+      CubeIdVec & ids = frames[i].borderCubes;
+      size_t n = 0;
+      for (CubeIdVec::const_iterator j = ids.begin(); j != ids.end(); ++j)
+        if (cubeLevel[*j] == i && !cubeMark[*j]) {
+          cubeMark[*j] = true;
+          ids[n++] = *j;
+        }
+      ids.resize(n);
+      for (CubeIdVec::const_iterator j = ids.begin(); j != ids.end(); ++j)
+        cubeMark[*j] = false;
+    }
+
     // ~cube was found to be inductive relative to level; now see if
     // we can do better.
     size_t generalize(size_t level, LitVec cube) {
@@ -708,22 +1516,25 @@ namespace IC3 {
 
     size_t cexState;  // beginning of counterexample trace
 
-    // Process obligations according to priority. HZ: this is recursive_block
-    bool handleObligations(PriorityQueue obls) {
-      while (!obls.empty()) {
-        PriorityQueue::iterator obli = obls.begin();
-        Obligation obl = *obli;
+    // Process obligations (of obls) according to priority. HZ: this
+    // is recursive_block
+    bool handleObligations() {
+      Profile::Scope scope(prof, PhBlock);  // stats
+      LitVec latches;
+      while (!obls.empty() && !stopped()) {
+        checkMemory();
+        Obligation obl = obls.top();
         LitVec core;
         size_t predi;
+        getLits(state(obl.state).latches, latches);
         // Is the obligation fulfilled?
-        if (consecution(obl.level, state(obl.state).latches, obl.state, 
-                        &core, &predi)) {
+        if (consecution(obl.level, latches, obl.state, &core, &predi)) {
           // Yes, so generalize and possibly produce a new obligation
           // at a higher level.
-          obls.erase(obli);
+          obls.pop();
           size_t n = generalize(obl.level, core);
           if (n <= k)
-            obls.insert(Obligation(obl.state, n, obl.depth));
+            obls.push(Obligation(obl.state, n, obl.depth));
         }
         else if (obl.level == 0) {
           // No, in fact an initial state is a predecessor.
@@ -731,38 +1542,75 @@ namespace IC3 {
           return false;
         }
         else {
-          ++nCTI;  // stats
+          ++nCTI; prof.cti(obl.level);  // stats
           // No, so focus on predecessor.
-          obls.insert(Obligation(predi, obl.level-1, obl.depth+1));
+          obls.push(Obligation(predi, obl.level-1, obl.depth+1));
         }
       }
       return true;
     }
 
+    // Adopts the lemmas that the other instances have published since
+    // the last call.  A lemma published at level L is checked relative
+    // to frame j-1, where j = min(L, k+1), and, if it holds, its core
+    // is added to frame j.  It is called where no obligations or
+    // States are live.
+    void importLemmas() {
+      if (!channel) return;
+      Profile::Scope scope(prof, PhImport);  // stats
+      received.clear();
+      channel->receive(worker, channelCursor, received);
+      publishing = false;
+      for (vector<SharedLemma>::iterator i = received.begin(); 
+           i != received.end() && !stopped(); ++i) {
+        size_t j = min(i->level, k+1);
+        if (j == 0) continue;
+        sort(i->cube.begin(), i->cube.end());
+        // only the accepted core is interned (by addCube())
+        CubeId id = cubes.find(i->cube);
+        if (id != CubeStore::NoCube && id < cubeLevel.size() 
+            && cubeLevel[id] >= j) continue;
+        ++nImportTried;  // stats
+        LitVec core;
+        if (initiation(i->cube) && consecution(j-1, i->cube, 0, &core)) {
+          ++nImported;  // stats
+          addCube(j, core);
+        }
+      }
+      publishing = true;
+    }
+
     bool trivial;  // indicates whether strengthening was required
                    // during major iteration
 
     // Strengthens frontier to remove error successors.
     bool strengthen() {
+      Profile::Scope scope(prof, PhStrengthen);  // stats
       Frame & frontier = frames[k];
       trivial = true;  // whether any cubes are generated
       earliest = k+1;  // earliest frame with enlarged borderCubes
-      while (true) {
-        ++nQuery; startTimer();  // stats
-        bool rv = frontier.consecution->solve(model.primedError());
-        endTimer(satTime);
+      while (!stopped()) {
+        importLemmas();
+        checkMemory();
+        startQuery();  // stats
+        MSLitVec assumps;
+        assumps.push(model.primedError());
+        frameAssumps(k, assumps);
+        bool rv = frontier.consecution->solve(assumps);
+        endQuery();
         if (!rv) return true;
         // handle CTI with error successor
-        ++nCTI;  // stats
+        ++nCTI; prof.cti(k);  // stats
         trivial = false;
-        PriorityQueue pq;
         // enqueue main obligation and handle
-        pq.insert(Obligation(stateOf(frontier), k-1, 1));
-        if (!handleObligations(pq))
+        obls.clear();
+        obls.push(Obligation(stateOf(frontier), k-1, 1));
+        if (!handleObligations())
           return false;
         // finished with States for this iteration, so clean up
         resetStates();
       }
+      return true;
     }
 
     // Propagates clauses forward using induction.  If any frame has
@@ -772,64 +1620,403 @@ namespace IC3 {
     // in the original paper.
     bool propagate() {
       if (verbose > 1) cout << "propagate" << endl;
-      // 1. clean up: remove c in frame i if c appears in frame j when i < j
-      CubeSet all;
+      importLemmas();
+      checkMemory();
+      // 1. clean up: remove c in frame i if c has moved to frame j > i
       for (size_t i = k+1; i >= earliest; --i) {
-        Frame & fr = frames[i];
-        CubeSet rem, nall;
-        set_difference(fr.borderCubes.begin(), fr.borderCubes.end(),
-                       all.begin(), all.end(),
-                       inserter(rem, rem.end()), LitVecComp());
         if (verbose > 1)
-          cout << i << " " << fr.borderCubes.size() << " " << rem.size() << " ";
-        fr.borderCubes.swap(rem);
-        set_union(rem.begin(), rem.end(),
-                  all.begin(), all.end(), 
-                  inserter(nall, nall.end()), LitVecComp());
-        all.swap(nall);
-        for (CubeSet::const_iterator i = fr.borderCubes.begin(); 
-             i != fr.borderCubes.end(); ++i)
-          assert (all.find(*i) != all.end());
+          cout << i << " " << frames[i].borderCubes.size() << " ";
+        compact(i);
         if (verbose > 1)
-          cout << all.size() << endl;
+          cout << frames[i].borderCubes.size() << endl;
       }
       // 2. check if each c in frame i can be pushed to frame j
-      for (size_t i = trivial ? k : 1; i <= k; ++i) {
-        int ckeep = 0, cprop = 0, cdrop = 0;
+      if (threads > 1 && !oneSolver ? pushParallel() : push()) return true;
+      // 3. rebuild solvers that have accumulated too much garbage
+      recycle();
+      // 4. simplify frames
+      prof.enter(PhSimplify);  // stats
+      if (oneSolver)
+        frames[0].consecution->simplify();
+      else
+        for (size_t i = trivial ? k : 1; i <= k+1; ++i)
+          frames[i].consecution->simplify();
+      lifts->simplify();
+      prof.leave();  // stats
+      return false;
+    } // end of propagate
+
+    // Solvers accumulate garbage: a variable for each query's
+    // activation literal, which is released afterward, and the
+    // clauses of lemmas that have since been subsumed.  A solver is
+    // rebuilt from the TR and the live lemmas when its released
+    // variables outnumber the variables it was built with, or when
+    // more than half of its (at least recycleMin) lemma clauses are
+    // obsolete --- or, if forced, regardless, which also drops its
+    // learnt clauses.
+    static const size_t recycleMin = 1000;
+    bool garbage(int baseVars, size_t released, size_t lemmas,
+                 size_t live) const {
+      return released > (size_t) baseVars
+        || (lemmas >= recycleMin && 2 * (lemmas - live) > lemmas);
+    }
+
+    void recycle(bool force = false) {
+      Profile::Scope scope(prof, PhRecycle);  // stats
+      startTimer();  // stats
+      // live[i]: lemmas in frames i and up
+      vector<size_t> live(frames.size()+1, 0);
+      for (size_t i = frames.size()-1; i >= 1; --i) {
+        compact(i);
+        live[i] = live[i+1] + frames[i].borderCubes.size();
+      }
+      live[0] = live[1];
+      for (size_t i = 0; i < (oneSolver ? 1 : frames.size()); ++i) {
         Frame & fr = frames[i];
-        for (CubeSet::iterator j = fr.borderCubes.begin(); 
-             j != fr.borderCubes.end();) {
+        if (!force && !garbage(fr.baseVars, fr.released, fr.lemmas, live[i]))
+          continue;
+        ++nRecycled;  // stats
+        delete fr.consecution;
+        buildFrame(fr);
+        if (oneSolver)
+          for (size_t j = 1; j < frames.size(); ++j) {
+            frames[j].consecution = fr.consecution;
+            frames[j].act = Minisat::mkLit(fr.consecution->newVar());
+          }
+        if (!oneSolver && i == 0) continue;  // F_0 has no lemmas
+        // reload the lemmas of frames i and up
+        for (size_t j = max(i, (size_t) 1); j < frames.size(); ++j)
+          for (CubeIdVec::const_iterator id = frames[j].borderCubes.begin();
+               id != frames[j].borderCubes.end(); ++id) {
+            MSLitVec cls;
+            for (const Minisat::Lit * l = cubes.begin(*id); 
+                 l != cubes.end(*id); ++l)
+              cls.push(~*l);
+            if (oneSolver) cls.push(~frames[j].act);
+            fr.consecution->addClause_(cls);
+            ++fr.lemmas;
+          }
+      }
+      // the replicas hold the lemmas of all frames, as frame 1 does
+      for (size_t t = 0; t < replicas.size(); ++t) {
+        Replica & r = replicas[t];
+        if (!force && !garbage(r.baseVars, r.released, r.lemmas, live[1]))
+          continue;
+        ++nRecycled;  // stats
+        delete r.slv;
+        buildReplica(r);
+      }
+      trimLemmaLog();
+      if (force || garbage(liftsBaseVars, liftsReleased, 0, 0)) {
+        ++nRecycled;  // stats
+        delete lifts;
+        buildLifts();
+      }
+      endTimer(recycleTime);
+    }
+
+    // Estimated memory use, in bytes, by subsystem.
+    struct MemUse {
+      size_t frames;  // frame solvers, including -mj replicas
+      size_t lifts;   // lifting solver
+      size_t lemmas;  // cube store, subsumption index, frame lists
+      size_t states;  // CTI pool and its literals
+      size_t model;   // shared by the instances of a portfolio
+    };
+    MemUse memUse() const {
+      MemUse mu;
+      mu.frames = 0;
+      for (size_t i = 0; i < (oneSolver ? 1 : frames.size()); ++i)
+        mu.frames += Model::solverBytes(*frames[i].consecution);
+      for (size_t i = 0; i < replicas.size(); ++i)
+        mu.frames += Model::solverBytes(*replicas[i].slv);
+      mu.lifts = Model::solverBytes(*lifts);
+      mu.lemmas = cubes.bytes() + subsumption.bytes()
+        + cubeLevel.capacity() * sizeof(size_t) + cubeMark.capacity() / 8
+        + lemmaLog.capacity() * sizeof(lemmaLog[0]);
+      for (size_t i = 0; i < frames.size(); ++i)
+        mu.lemmas += frames[i].borderCubes.capacity() * sizeof(CubeId);
+      mu.states = states.capacity() * sizeof(State)
+        + stateLits.capacity() * sizeof(Minisat::Lit);
+      mu.model = model.bytes();
+      return mu;
+    }
+
+    // The process's resident memory in bytes, or 0 if unknown.
+    // Without /proc, it is the peak resident memory from getrusage(),
+    // which reclaim() cannot lower; peak is then set, if given.
+    static size_t residentBytes(bool * peak = NULL) {
+      if (peak) *peak = false;
+      std::ifstream statm("/proc/self/statm");
+      size_t size, resident;
+      if (statm >> size >> resident)
+        return resident * (size_t) sysconf(_SC_PAGESIZE);
+      struct rusage ru;
+      if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+      if (peak) *peak = true;
+      return (size_t) ru.ru_maxrss * 1024;  // kB on Linux
+    }
+
+    // residentBytes(), or if that is unknown, the estimates.
+    size_t memoryBytes() const {
+      size_t rss = residentBytes();
+      if (rss) return rss;
+      MemUse mu = memUse();
+      return mu.frames + mu.lifts + mu.lemmas + mu.states + mu.model;
+    }
+
+    // If set, the bytes of resident memory that the process should
+    // stay below.  checkMemory() polls it every memPeriod ns at the
+    // safe points of strengthen(), handleObligations(), and
+    // propagate().  From 80% of the limit (or, after a reclaim(),
+    // from 10% of the limit above what that left) memory is
+    // reclaimed.  If the process is still over the limit, the other
+    // instances of the run reclaim theirs at their next poll, and
+    // only when all of them have, and it is over the limit still,
+    // do they all stop rather than being left to be killed.
+    size_t memLimit;
+    uint64_t memChecked;  // time of the last poll
+    size_t memFloor;      // resident memory after the last reclaim()
+    static const uint64_t memPeriod = 50000000;
+
+    void checkMemory() {
+      if (!memLimit) return;
+      uint64_t t = Profile::now();
+      if (t - memChecked < memPeriod) return;
+      memChecked = t;
+      MemShare & ms = *memShare;
+      size_t rss = memoryBytes();
+      if (!ms.pressed.load(std::memory_order_relaxed)
+          && rss < max(memLimit / 10 * 8, memFloor + memLimit / 10))
+        return;
+      bool done;
+      {
+        std::lock_guard<std::mutex> lock(ms.mutex);
+        done = ms.reclaimed[worker];
+      }
+      if (!done) {
+        reclaim();
+        rss = memoryBytes();
+        memFloor = rss;
+      }
+      std::lock_guard<std::mutex> lock(ms.mutex);
+      if (rss <= memLimit) {
+        // enough for now: a later shortage starts over
+        fill(ms.reclaimed.begin(), ms.reclaimed.end(), false);
+        ms.pressed = false;
+        return;
+      }
+      ms.reclaimed[worker] = true;
+      ms.pressed = true;
+      if (find(ms.reclaimed.begin(), ms.reclaimed.end(), false)
+          == ms.reclaimed.end()) {
+        ms.outOfMemory = true;
+        if (verbose) cout << "Out of memory: giving up" << endl;
+      }
+    }
+
+    // Frees what can be rebuilt or done without: the solvers are
+    // rebuilt from their lemmas, without learnt clauses or garbage;
+    // speculative literal dropping (-mj) is given up along with its
+    // replicas; and spare capacity of the state pool is released.
+    void reclaim() {
+      ++nReclaims;  // stats
+      stopDropWorkers();
+      micThreads = 1;
+      recycle(true);
+      if (states.empty()) {
+        vector<State>().swap(states);
+        LitVec().swap(stateLits);
+      }
+#ifdef __GLIBC__
+      malloc_trim(0);  // return the freed memory to the system
+#endif
+    }
+
+    // Moves lemma id of frame i, shown to be inductive relative to
+    // frame i with the given core, to frame i+1.
+    void pushLemma(size_t i, CubeId id, const LitVec & cube, LitVec & core)
+    {
+      prof.pushed(i+1);  // stats
+      // only add to frame i+1 unless the core is reduced, in which
+      // case the original cube is dropped
+      if (core.size() < cube.size()) {
+        removeCube(id);
+        addCube(i+1, core, true, true);
+      }
+      else
+        addCube(i+1, core, false, true);  // moves id to frame i+1
+    }
+
+    // Pushes the lemmas of frames 1 (or k if trivial) through k
+    // forward where possible.  Returns true if some frame is left
+    // empty, in which case it is inductive.
+    bool push() {
+      Profile::Scope scope(prof, PhPush);  // stats
+      LitVec cube;
+      for (size_t i = trivial ? k : 1; i <= k && !stopped(); ++i) {
+        int ckeep = 0, cprop = 0, cdrop = 0;
+        compact(i);
+        CubeIdVec & ids = frames[i].borderCubes;
+        size_t n = 0;
+        for (size_t j = 0; j < ids.size(); ++j) {
+          CubeId id = ids[j];
+          if (cubeLevel[id] != i) continue;  // subsumed in the meantime
+          cubes.get(id, cube);
           LitVec core;
-          if (consecution(i, *j, 0, &core)) {
+          if (consecution(i, cube, 0, &core)) {
             ++cprop;
-            // only add to frame i+1 unless the core is reduced
-            addCube(i+1, core, core.size() < j->size(), true);
-            CubeSet::iterator tmp = j;
-            ++j;
-            fr.borderCubes.erase(tmp);
+            pushLemma(i, id, cube, core);
           }
           else {
             ++ckeep;
-            ++j;
+            ids[n++] = id;
           }
         }
+        ids.resize(n);
+        compact(i);  // kept cubes may have been subsumed since
         if (verbose > 1)
           cout << "Pushing from F" << i << " ckeep:" << ckeep << " cprop:" << cprop << " cdrop" << cdrop << endl;
-        if (fr.borderCubes.empty()) {
+        if (ids.empty()) {
           inductive_frame = i; // HZ: record the frame that got all propagated
           return true;
         }
       }
-      // 3. simplify frames
-      for (size_t i = trivial ? k : 1; i <= k+1; ++i)
-        frames[i].consecution->simplify();
-      lifts->simplify();
       return false;
-    } // end of propagate
+    }
+
+    // The outcome of a push check done by a worker thread.
+    struct PushResult {
+      CubeId id;
+      bool pushed;
+      LitVec core;  // initiation is not yet checked
+    };
+
+    // Checks whether each of the given lemmas of frame i is inductive
+    // relative to frame i.  Runs on a worker thread, so it uses only
+    // frame i's solver and reads nothing that the other workers
+    // modify.
+    void pushCheck(size_t i, const CubeIdVec & ids,
+                   vector<PushResult> & results, int & queries)
+    {
+      Minisat::Solver & slv = *frames[i].consecution;
+      results.resize(ids.size());
+      LitVec cube;
+      for (size_t j = 0; j < ids.size(); ++j) {
+        PushResult & r = results[j];
+        r.id = ids[j];
+        cubes.get(r.id, cube);
+        MSLitVec assumps;
+        ++queries;
+        r.pushed = !relativeInduction(i, cube, assumps, false);
+        if (r.pushed)
+          for (LitVec::const_iterator l = cube.begin(); l != cube.end(); ++l)
+            if (slv.conflict.has(~model.primeLit(*l)))
+              r.core.push_back(*l);
+        release(i, ~assumps[0]);
+      }
+    }
+
+    // Parallel version of push().  In each round, the frames with
+    // unchecked lemmas are handed out to the worker threads, each of
+    // which checks one frame's lemmas at a time on that frame's
+    // solver.  The results are then merged in frame order on this
+    // thread, exactly as push() applies them; a check made against
+    // the frame as it stood at the start of the round remains valid
+    // because frames only grow.  Lemmas pushed into a frame during
+    // the merge are checked in the next round.  Results, including
+    // inductive_frame, do not depend on scheduling, nor on the thread
+    // count as long as it is at least 2.  They can differ from those
+    // of push(), which checks a frame's lemmas only after the pushes
+    // into it from the frame below, and after the reduced cores of
+    // the frame's earlier lemmas, have landed; a lemma kept here is
+    // not checked again in the same call.
+    bool pushParallel() {
+      Profile::Scope scope(prof, PhPush);  // stats
+      size_t lo = trivial ? k : 1;
+      vector<CubeIdVec> pending(k+1);
+      for (size_t i = lo; i <= k; ++i) {
+        compact(i);
+        pending[i] = frames[i].borderCubes;
+      }
+      LitVec cube;
+      for (bool first = true; ; first = false) {
+        vector<size_t> tasks;
+        for (size_t i = lo; i <= k; ++i)
+          if (first || !pending[i].empty())
+            tasks.push_back(i);
+        if (tasks.empty() || stopped()) return false;
+
+        vector< vector<PushResult> > results(tasks.size());
+        vector<int> queries(tasks.size(), 0);
+        std::atomic<size_t> next(0);
+        startTimer();  // stats: counts the CPU time of all workers
+        vector<std::thread> workers;
+        for (size_t w = 0; w < min((size_t) threads, tasks.size()); ++w)
+          workers.push_back(std::thread([&]() {
+                for (size_t t; (t = next++) < tasks.size(); )
+                  pushCheck(tasks[t], pending[tasks[t]], results[t], queries[t]);
+              }));
+        for (size_t w = 0; w < workers.size(); ++w)
+          workers[w].join();
+        endTimer(satTime);
+
+        for (size_t t = 0; t < tasks.size(); ++t)
+          pending[tasks[t]].clear();
+        for (size_t t = 0; t < tasks.size(); ++t) {
+          size_t i = tasks[t];
+          nQuery += queries[t];
+          int ckeep = 0, cprop = 0;
+          size_t arrived = frames[i+1].borderCubes.size();
+          for (size_t j = 0; j < results[t].size(); ++j) {
+            PushResult & r = results[t][j];
+            if (cubeLevel[r.id] != i) continue;  // subsumed in the meantime
+            if (r.pushed) {
+              ++cprop;
+              cubes.get(r.id, cube);
+              if (!initiation(r.core))
+                r.core = cube;
+              pushLemma(i, r.id, cube, r.core);
+            }
+            else
+              ++ckeep;
+          }
+          compact(i);
+          if (verbose > 1)
+            cout << "Pushing from F" << i << " ckeep:" << ckeep << " cprop:" << cprop << endl;
+          if (frames[i].borderCubes.empty()) {
+            inductive_frame = i;
+            return true;
+          }
+          // the lemmas that just arrived in frame i+1 are new to it
+          if (i < k) {
+            const CubeIdVec & ids = frames[i+1].borderCubes;
+            for (size_t j = arrived; j < ids.size(); ++j)
+              pending[i+1].push_back(ids[j]);
+          }
+        }
+        // drop pending lemmas that were subsumed during the merge
+        for (size_t i = lo; i <= k; ++i) {
+          size_t n = 0;
+          for (size_t j = 0; j < pending[i].size(); ++j)
+            if (cubeLevel[pending[i][j]] == i)
+              pending[i][n++] = pending[i][j];
+          pending[i].resize(n);
+        }
+      }
+    }
 
     int nQuery, nCTI, nCTG, nmic;
-    clock_t startTime, satTime;
+    clock_t startTime, satTime, simTime;
+    int nSimLifts;
     int nCoreReduced, nAbortJoin, nAbortMic;
+    int nFwdSubsumed, nBwdSubsumed;
+    int nRecycled;
+    clock_t recycleTime;
+    int nChunkQueries, nChunkDropped;
+    int nSpecQueries, nSpecDropped, nSpecReused;
+    int nImportTried, nImported;
+    int nReclaims;
     clock_t time() {
       struct tms t;
       times(&t);
@@ -838,6 +2025,22 @@ namespace IC3 {
     clock_t timer;
     void startTimer() { timer = time(); }
     void endTimer(clock_t & t) { t += (time() - timer); }
+    // Bracket a SAT query made on this instance's thread.
+    void startQuery() { ++nQuery; startTimer(); prof.startQuery(); }
+    void endQuery() { endTimer(satTime); prof.endQuery(); }
+
+    // Queries made by worker threads (pushParallel(), dropParallel())
+    // are not timed individually; their rounds count toward the
+    // enclosing phase.
+    Profile prof;
+    void writeProfile(std::ostream & out, const char * event) {
+      out << "{\"event\":\"" << event << "\",\"instance\":" << worker
+          << ",\"k\":" << k << ",\"queries\":" << nQuery
+          << ",\"ctis\":" << nCTI << ",\"ctgs\":" << nCTG
+          << ",\"mics\":" << nmic << ",";
+      prof.writeJson(out);
+      out << "}" << endl;
+    }
     void printStats() {
       if (!verbose) return;
       clock_t etime = time();
@@ -847,6 +2050,18 @@ namespace IC3 {
       cout << ". % SAT:        " << (int) (100 * (((double) satTime) / ((double) etime))) << endl;
       cout << ". K:            " << k << endl;
       cout << ". # Queries:    " << nQuery << endl;
+      int nvars = lifts->nVars(), ncls = lifts->nClauses();
+      for (size_t i = 0; i < frames.size(); ++i)
+        if (!oneSolver || i == 0) {
+          nvars += frames[i].consecution->nVars();
+          ncls += frames[i].consecution->nClauses();
+        }
+      cout << ". Solver vars:  " << nvars << endl;
+      cout << ". Solver cls.:  " << ncls << endl;
+      if (tsim) {
+        cout << ". % Sim.:       " << (int) (100 * (((double) simTime) / ((double) etime))) << endl;
+        cout << ". # Sim. lifts: " << nSimLifts << endl;
+      }
       cout << ". # CTIs:       " << nCTI << endl;
       cout << ". # CTGs:       " << nCTG << endl;
       cout << ". # mic calls:  " << nmic << endl;
@@ -855,10 +2070,40 @@ namespace IC3 {
       cout << ". # Red. cores: " << nCoreReduced << endl;
       cout << ". # Int. joins: " << nAbortJoin << endl;
       cout << ". # Int. mics:  " << nAbortMic << endl;
+      cout << ". # Fwd. subs.: " << nFwdSubsumed << endl;
+      cout << ". # Bwd. subs.: " << nBwdSubsumed << endl;
+      if (chunked) {
+        cout << ". # Chunk qry.: " << nChunkQueries << endl;
+        cout << ". # Chunk drop: " << nChunkDropped << endl;
+      }
+      if (micThreads > 1) {
+        cout << ". # Spec. qry.: " << nSpecQueries << endl;
+        cout << ". # Spec. drop: " << nSpecDropped << endl;
+        cout << ". # Spec. used: " << nSpecReused << endl;
+      }
+      if (channel) {
+        cout << ". # Recv. lem.: " << nImportTried << endl;
+        cout << ". # Imp. lem.:  " << nImported << endl;
+      }
+      cout << ". # Recycles:   " << nRecycled << endl;
+      MemUse mu = memUse();
+      cout << ". Mem. frames:  " << mu.frames / 1024 << " kB" << endl;
+      cout << ". Mem. lifts:   " << mu.lifts / 1024 << " kB" << endl;
+      cout << ". Mem. lemmas:  " << mu.lemmas / 1024 << " kB" << endl;
+      cout << ". Mem. states:  " << mu.states / 1024 << " kB" << endl;
+      cout << ". Mem. model:   " << mu.model / 1024 << " kB" << endl;
+      cout << ". Mem. RSS:     " << residentBytes() / 1024 << " kB" << endl;
+      if (memLimit) cout << ". # Reclaims:   " << nReclaims << endl;
+      cout << ". % Recycle:    " << (int) (100 * (((double) recycleTime) / ((double) etime))) << endl;
       if (numUpdates) cout << ". Avg lits/cls: " << numLits / numUpdates << endl;
     }
 
-    friend bool check(Model & model, const ClauseBuf & clsbuf, int verbose, bool basic, bool random, bool dump);
+    friend void configure(IC3 & ic3, const Options & opts, unsigned i);
+    friend class KernelBench;  // see microbench.cpp
+    friend Result checkProperty(Model & model, const ClauseBuf & clsbuf,
+                                const Options & opts,
+                                vector<LitVec> & background,
+                                uint64_t deadline);
 
   };
 
@@ -885,33 +2130,184 @@ namespace IC3 {
   }
 
   // External function to make the magic happen.
-  bool check(Model & model, const ClauseBuf & clsbuf, int verbose, bool basic, bool random, bool dump) {
+  // Generalization settings of the portfolio instances other than
+  // the first, which runs as configured by the options: maxDepth,
+  // maxCTGs, maxJoins, micAttempts.  If there are more instances than
+  // settings, the settings repeat with other seeds.
+  static const size_t portfolioSettings[][4] = {
+    {1, 3, 1<<20, 3},  // default, but randomized
+    {0, 0, 0, 3},      // basic
+    {2, 3, 1<<20, 3},  // deeper CTG recursion
+    {1, 1, 1<<20, 5},
+    {1, 5, 1<<20, 2},
+    {0, 0, 0, 1<<20}   // basic, exhaustive mic
+  };
+
+  // Configures instance i of a run.
+  void configure(IC3 & ic3, const Options & opts, unsigned i) {
+    ic3.threads = opts.threads;
+    ic3.aigMap = opts.aigMap;
+    ic3.oneSolver = opts.oneSolver;
+    ic3.chunked = opts.chunked;
+    ic3.micThreads = opts.micThreads;
+    ic3.memLimit = opts.memLimit << 20;
+    static bool warned = false;
+    bool peak;
+    if (ic3.memLimit && !warned && IC3::residentBytes(&peak) && peak) {
+      cout << "No /proc/self/statm: --mem-limit applies to the peak "
+           << "resident memory" << endl;
+      warned = true;
+    }
+    if (opts.ternary) ic3.tsim = new TernarySim(ic3.model);
+    if (i == 0) {
+      if (opts.basic) {
+        ic3.maxDepth = 0;
+        ic3.maxJoins = 0;
+        ic3.maxCTGs = 0;
+      }
+      if (opts.random) {
+        ic3.random = true;
+        ic3.seed = (unsigned) rand();
+      }
+      return;
+    }
+    size_t n = sizeof(portfolioSettings) / sizeof(portfolioSettings[0]);
+    const size_t * ps = portfolioSettings[(i-1) % n];
+    ic3.maxDepth = ps[0];
+    ic3.maxCTGs = ps[1];
+    ic3.maxJoins = ps[2];
+    ic3.micAttempts = ps[3];
+    ic3.random = true;
+    ic3.seed = opts.random ? (unsigned) rand() : i;
+  }
+
+  // Checks the model's selected property, given background cubes
+  // (see IC3::background), until the deadline (see IC3::deadline).
+  // If the property holds, the cubes of its invariant are added to
+  // the background.
+  Result checkProperty(Model & model, const ClauseBuf & clsbuf,
+                       const Options & opts, vector<LitVec> & background,
+                       uint64_t deadline)
+  {
     if (!baseCases(model)) {
-      if (dump) {
+      if (opts.json)
+        *opts.json << "{\"event\":\"failed\",\"k\":0}" << endl;
+      if (opts.dump) {
         std::ofstream fout("inv.cnf");
         fout << "sat" << endl;
       }
-      return false;
+      return Fails;
     }
-    IC3 ic3(model);
-    ic3.verbose = verbose;
-    if (basic) {
-      ic3.maxDepth = 0;
-      ic3.maxJoins = 0;
-      ic3.maxCTGs = 0;
+    // With a portfolio, the instances race in threads over the shared
+    // Model; the first to finish wins and cancels the others.
+    unsigned n = max(1u, opts.portfolio);
+    LemmaChannel * channel = 
+      opts.share && n > 1 ? new LemmaChannel() : NULL;
+    IC3::MemShare memShare(n);
+    vector<IC3 *> ic3s;
+    for (unsigned i = 0; i < n; ++i) {
+      ic3s.push_back(new IC3(model));
+      configure(*ic3s.back(), opts, i);
+      ic3s.back()->background = &background;
+      ic3s.back()->channel = channel;
+      ic3s.back()->memShare = &memShare;
+      ic3s.back()->worker = i;
+      ic3s.back()->deadline = deadline;
     }
-    if (random) ic3.random = true;
-    bool rv = ic3.check(clsbuf);
-    if (!rv && verbose > 1) {
+    // per-frame records come from the instance run as configured
+    ic3s[0]->json = opts.json;
+    ic3s[0]->checkpointFile = opts.checkpoint;
+    for (unsigned i = 0; i < n; ++i)
+      ic3s[i]->resume = opts.resume;
+    std::atomic<bool> stop(false);
+    std::atomic<int> winner(-1);
+    vector<char> rvs(n);
+    if (n == 1) {
+      ic3s[0]->verbose = opts.verbose;
+      rvs[0] = ic3s[0]->check(clsbuf);
+      winner = 0;
+    }
+    else {
+      vector<std::thread> runs;
+      for (unsigned i = 0; i < n; ++i) {
+        ic3s[i]->stop = &stop;
+        runs.push_back(std::thread([&, i]() {
+              rvs[i] = ic3s[i]->check(clsbuf);
+              // a cancelled instance always loses the race
+              int none = -1;
+              if (winner.compare_exchange_strong(none, (int) i))
+                stop = true;
+            }));
+      }
+      for (unsigned i = 0; i < n; ++i)
+        runs[i].join();
+    }
+    IC3 & ic3 = *ic3s[winner];
+    Result rv = rvs[winner] ? Holds : ic3.abandoned ? Unknown : Fails;
+    ic3.verbose = opts.verbose;
+    if (n > 1 && opts.verbose)
+      cout << "Portfolio winner: instance " << winner << endl;
+    if (rv == Fails && opts.verbose > 1) {
       ic3.printWitness();
     }
-    if (!rv && dump) {
+    if (rv == Unknown) {
+      cout << "Unknown: stopped at k = " << ic3.k << endl;
+      // keep the lemmas derived since the last checkpoint
+      if (opts.checkpoint) {
+        ic3.checkpointFile = opts.checkpoint;
+        ic3.saveCheckpoint();
+      }
+    }
+    if (rv == Fails && opts.dump) {
         std::ofstream fout("inv.cnf");
         fout << "sat" << endl;
     }
-    if (verbose) ic3.printStats();
-    if (rv && dump) ic3.printInvariant();
+    if (opts.verbose) ic3.printStats();
+    if (opts.json) 
+      ic3.writeProfile(*opts.json, rv == Holds ? "proved" 
+                                   : rv == Fails ? "failed" : "unknown");
+    if (rv == Holds && opts.dump) ic3.printInvariant();
+    if (rv == Unknown && opts.dump) ic3.printPartial();
+    if (rv == Holds) ic3.invariantCubes(background);
+    for (unsigned i = 0; i < n; ++i)
+      delete ic3s[i];
+    if (channel) delete channel;
     return rv;
   }
 
+  // The Profile::now() time at which a check started now must stop.
+  static uint64_t deadlineOf(const Options & opts) {
+    if (opts.timeout <= 0) return 0;
+    return Profile::now() + (uint64_t) (opts.timeout * 1e9);
+  }
+
+  Result check(Model & model, const ClauseBuf & clsbuf, const Options & opts) {
+    vector<LitVec> background;
+    return checkProperty(model, clsbuf, opts, background, deadlineOf(opts));
+  }
+
+  // A proved property's invariant holds in all reachable states, so
+  // it is sound to assert it in the frames of the properties checked
+  // after it, whatever their errors: see IC3::background.
+  void checkAll(Model & model, const ClauseBuf & clsbuf,
+                const Options & opts)
+  {
+    Options popts = opts;
+    // a single inv.cnf or checkpoint cannot hold all results
+    popts.dump = false;
+    popts.checkpoint = NULL;
+    popts.resume = NULL;
+    vector<LitVec> background;
+    uint64_t deadline = deadlineOf(opts);
+    for (size_t i = 0; i < model.numProperties(); ++i) {
+      model.setProperty(i);
+      // once out of time, the remaining properties are not started
+      bool over = interrupted.load(std::memory_order_relaxed)
+        || (deadline && Profile::now() >= deadline);
+      Result rv = over ? Unknown 
+        : checkProperty(model, clsbuf, popts, background, deadline);
+      cout << i << " " << rv << endl;
+    }
+  }
+
 }
@@ -24,17 +24,61 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef IC3_h_INCLUDED
 #define IC3_h_INCLUDED
 
+#include "Checkpoint.h"
 #include "Model.h"
+#include "Preprocess.h"
 #include "clausebuf.h"
 
 namespace IC3 {
 
-  bool check(Model & model,
-             const ClauseBuf & clsbuf,
-             int verbose = 0,       // 0: silent, 1: stats, 2: informative
-             bool basic = false,    // simple inductive generalization
-             bool random = false,   // random runs for statistical profiling
-             bool dump = false);
+  // Settings of a run; the defaults give the standard deterministic
+  // IC3 configuration.
+  struct Options {
+    Options() :
+      verbose(0), basic(false), chunked(false), random(false), dump(false),
+      threads(1), micThreads(1), portfolio(1), share(false), ternary(false),
+      oneSolver(false), aigMap(NULL), json(NULL), memLimit(0), timeout(0),
+      checkpoint(NULL), resume(NULL) {}
+    int verbose;         // 0: silent, 1: stats, 2: informative
+    bool basic;          // simple inductive generalization
+    bool chunked;        // drop literals in chunks before one by one
+    bool random;         // random runs for statistical profiling
+    bool dump;           // write the result to inv.cnf
+    unsigned threads;    // worker threads for clause propagation
+    unsigned micThreads; // worker threads for speculative literal drops
+    unsigned portfolio;  // differently configured instances to race
+    bool share;          // exchange lemmas between the instances
+    bool ternary;        // lift CTIs by ternary simulation
+    bool oneSolver;      // one solver for all frames (no parallel push)
+    const AigMap * aigMap;  // if preprocessed: to dump the invariant
+                            // over the original latches
+    std::ostream * json;    // if set: JSON profile records, one per line
+    size_t memLimit;        // MB of resident memory (0: unlimited)
+    double timeout;         // seconds of wall time (0: unlimited)
+    const char * checkpoint;   // if set: file to checkpoint the run to
+    const Checkpoint * resume; // if set: the run to continue (which
+                               // must fit the model)
+  };
+
+  // The outcome of a check, numbered as the result is printed (see
+  // the AIGER and HWMCC conventions).  A check is Unknown if it stops
+  // early: for lack of memory or time, or on interrupt().
+  enum Result { Holds = 0, Fails = 1, Unknown = 2 };
+
+  Result check(Model & model,
+               const ClauseBuf & clsbuf,
+               const Options & opts = Options());
+
+  // Checks each property of the model in turn (see
+  // multiModelFromAiger()), printing "<index> <0/1/2>" as each is
+  // decided.  The invariants of proved properties are reused.
+  void checkAll(Model & model,
+                const ClauseBuf & clsbuf,
+                const Options & opts = Options());
+
+  // Makes running checks stop at their next safe point with an
+  // Unknown result.  It is async-signal-safe.
+  void interrupt();
 
 }
 
@@ -0,0 +1,98 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include "LemmaChannel.h"
+
+LemmaChannel::LemmaChannel() : slots(Slots), head(0) {
+  for (size_t i = 0; i < Slots; ++i)
+  {
+    slots[i].seq.store(0, std::memory_order_relaxed);
+    slots[i].dropped.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LemmaChannel::publish(unsigned producer, size_t level, 
+                           const LitVec & cube)
+{
+  if (cube.size() > MaxLits) return;
+  size_t pos = head.fetch_add(1, std::memory_order_relaxed);
+  Slot & s = slots[pos & (Slots-1)];
+  uint64_t round = pos / Slots;
+  // Claim the slot unless it is being written or a later round has
+  // it.  It may still hold an earlier round than the previous one,
+  // whose writer was lapped and so dropped the lemmas since.
+  uint64_t seq = s.seq.load(std::memory_order_relaxed);
+  do {
+    if ((seq & 1) || seq > 2*round) {
+      // tell readers not to wait for this round
+      uint64_t d = s.dropped.load(std::memory_order_relaxed);
+      while (d < round+1 
+             && !s.dropped.compare_exchange_weak(d, round+1,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
+        ;
+      return;
+    }
+  } while (!s.seq.compare_exchange_weak(seq, 2*round+1,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed));
+  // order the odd seq before the data, for the reader's recheck
+  std::atomic_thread_fence(std::memory_order_release);
+  s.producer.store(producer, std::memory_order_relaxed);
+  s.level.store((uint32_t) level, std::memory_order_relaxed);
+  s.size.store((uint32_t) cube.size(), std::memory_order_relaxed);
+  for (size_t i = 0; i < cube.size(); ++i)
+    s.lits[i].store(Minisat::toInt(cube[i]), std::memory_order_relaxed);
+  s.seq.store(2*round+2, std::memory_order_release);
+}
+
+void LemmaChannel::receive(unsigned self, size_t & cursor, 
+                           vector<SharedLemma> & out)
+{
+  size_t end = head.load(std::memory_order_acquire);
+  if (end - cursor > Slots) cursor = end - Slots;  // lapped
+  SharedLemma lemma;
+  for (; cursor < end; ++cursor) {
+    Slot & s = slots[cursor & (Slots-1)];
+    uint64_t done = 2*(cursor / Slots)+2;
+    uint64_t seq = s.seq.load(std::memory_order_acquire);
+    if (seq == done-1) return;  // still being written: resume later
+    if (seq < done-1) {
+      // not yet claimed, unless its producer gave up
+      if (s.dropped.load(std::memory_order_acquire) < done/2) return;
+      continue;
+    }
+    if (seq != done) continue;  // already overwritten
+    lemma.producer = s.producer.load(std::memory_order_relaxed);
+    lemma.level = s.level.load(std::memory_order_relaxed);
+    size_t size = s.size.load(std::memory_order_relaxed);
+    if (size > MaxLits) continue;
+    lemma.cube.resize(size);
+    for (size_t i = 0; i < size; ++i)
+      lemma.cube[i] = Minisat::toLit(s.lits[i].load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) != seq) continue;
+    if (lemma.producer != self) out.push_back(lemma);
+  }
+}
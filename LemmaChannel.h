@@ -0,0 +1,81 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#ifndef LEMMACHANNEL_H_INCLUDED
+#define LEMMACHANNEL_H_INCLUDED
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include "Model.h"
+
+// A lemma as exchanged between IC3 instances: a cube whose negation
+// its producer holds at the given level.
+struct SharedLemma {
+  unsigned producer;
+  size_t level;
+  LitVec cube;
+};
+
+// A lossy, lock-free ring through which concurrent IC3 instances on
+// the same Model publish lemmas to each other.  Any number of
+// producers claim slots with one atomic increment; each slot is a
+// seqlock, so that a reader detects, and skips, a slot that was
+// overwritten while being read.  A reader stops at a position that
+// has been taken but not yet written, and resumes there on its next
+// call, unless the position's producer has given up.  Lemmas are
+// dropped, rather than waited for, when a producer finds its slot
+// still busy, when a reader falls more than a ring's length behind,
+// and when a cube is longer than MaxLits.  Consumers must therefore not rely on seeing
+// every lemma; nor, being imported from another search, should they
+// trust one without checking it.
+class LemmaChannel {
+public:
+  static const size_t Slots = 4096;   // a power of two
+  static const size_t MaxLits = 64;
+
+  LemmaChannel();
+
+  // Publishes a cube (which is not copied beyond the channel).
+  void publish(unsigned producer, size_t level, const LitVec & cube);
+
+  // Appends to out the lemmas published by producers other than
+  // self since cursor (initially 0), which is advanced.
+  void receive(unsigned self, size_t & cursor, vector<SharedLemma> & out);
+
+private:
+  struct Slot {
+    // 2r+2 once the lemma of round r is complete, odd while written
+    std::atomic<uint64_t> seq;
+    // 1 + the latest round whose producer gave up on the slot
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint32_t> producer, level, size;
+    std::atomic<int> lits[MaxLits];
+  };
+  std::vector<Slot> slots;
+  std::atomic<size_t> head;  // next position to claim
+};
+
+#endif
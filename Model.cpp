@@ -21,17 +21,16 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 
 #include "Model.h"
 #include "SimpSolver.h"
 #include "Vec.h"
 
-Minisat::Var Var::gvi = 0;
-
 Model::~Model() {
   if (inits) delete inits;
-  if (sslv) delete sslv;
 }
 
 const Var & Model::primeVar(const Var & v, Minisat::SimpSolver * slv) {
@@ -52,7 +51,7 @@ const Var & Model::primeVar(const Var & v, Minisat::SimpSolver * slv) {
     stringstream ss;
     ss << v.name() << "'";
     index = vars.size();
-    vars.push_back(Var(ss.str()));
+    vars.push_back(Var(ss.str(), (Minisat::Var) index));
     if (slv) {
       Minisat::Var _v = slv->newVar();
       assert (_v == vars.back().var());
@@ -76,9 +75,10 @@ Minisat::Solver * Model::newSolver() const {
 }
 
 void Model::loadTransitionRelation(Minisat::Solver & slv, bool primeConstraints) {
-  if (!sslv) {
+  if (!trVars && !trCacheDir.empty()) readTRCache();
+  if (!trVars) {
     // create a simplified CNF version of (this slice of) the TR
-    sslv = new Minisat::SimpSolver();
+    Minisat::SimpSolver * sslv = new Minisat::SimpSolver();
     // introduce all variables to maintain alignment
     for (size_t i = 0; i < vars.size(); ++i) {
       Minisat::Var nv = sslv->newVar();
@@ -93,41 +93,35 @@ void Model::loadTransitionRelation(Minisat::Solver & slv, bool primeConstraints)
       sslv->setFrozen(i->var(), true);
       sslv->setFrozen(primeVar(*i).var(), true);
     }
-    sslv->setFrozen(varOfLit(error()).var(), true);
-    sslv->setFrozen(varOfLit(primedError()).var(), true);
+    for (size_t i = 0; i < errors.size(); ++i) {
+      sslv->setFrozen(varOfLit(errors[i]).var(), true);
+      sslv->setFrozen(varOfLit(primedErrors[i]).var(), true);
+    }
     for (LitVec::const_iterator i = constraints.begin(); 
          i != constraints.end(); ++i) {
       Var v = varOfLit(*i);
       sslv->setFrozen(v.var(), true);
       sslv->setFrozen(primeVar(v).var(), true);
     }
-    // initialize with roots of required formulas
-    LitSet require;  // unprimed formulas
-    for (VarVec::const_iterator i = beginLatches(); i != endLatches(); ++i)
-      require.insert(nextStateFn(*i));
-    require.insert(_error);
-    require.insert(constraints.begin(), constraints.end());
-    LitSet prequire; // for primed formulas; always subset of require
-    prequire.insert(_error);
-    prequire.insert(constraints.begin(), constraints.end());
+    // cones of the required formulas
+    LitVec roots(errors);
+    roots.insert(roots.end(), constraints.begin(), constraints.end());
+    Cone prequire;  // for primed formulas; always subset of require
+    markCone(roots, prequire);
+    roots.insert(roots.end(), nextStateFns.begin(), nextStateFns.end());
+    Cone require;   // unprimed formulas
+    markCone(roots, require);
     // traverse AIG backward
     for (AigVec::const_reverse_iterator i = aig.rbegin(); 
          i != aig.rend(); ++i) {
       // skip if this row is not required
-      if (require.find(i->lhs) == require.end() 
-          && require.find(~i->lhs) == require.end())
-        continue;
+      if (!inCone(require, i->lhs)) continue;
       // encode into CNF
       sslv->addClause(~i->lhs, i->rhs0);
       sslv->addClause(~i->lhs, i->rhs1);
       sslv->addClause(~i->rhs0, ~i->rhs1, i->lhs);
-      // require arguments
-      require.insert(i->rhs0);
-      require.insert(i->rhs1);
       // primed: skip if not required
-      if (prequire.find(i->lhs) == prequire.end()
-          && prequire.find(~i->lhs) == prequire.end())
-        continue;
+      if (!inCone(prequire, i->lhs)) continue;
       // encode PRIMED form into CNF
       Minisat::Lit r0 = primeLit(i->lhs, sslv), 
         r1 = primeLit(i->rhs0, sslv), 
@@ -135,14 +129,13 @@ void Model::loadTransitionRelation(Minisat::Solver & slv, bool primeConstraints)
       sslv->addClause(~r0, r1);
       sslv->addClause(~r0, r2);
       sslv->addClause(~r1, ~r2, r0);
-      // require arguments
-      prequire.insert(i->rhs0);
-      prequire.insert(i->rhs1);
     }
     // assert literal for true
     sslv->addClause(btrue());
-    // assert ~error, constraints, and primed constraints
-    sslv->addClause(~_error);
+    // assert ~error (if it is the only one), constraints, and primed
+    // constraints
+    if (errors.size() == 1)
+      sslv->addClause(~_error);
     for (LitVec::const_iterator i = constraints.begin(); 
          i != constraints.end(); ++i) {
       sslv->addClause(*i);
@@ -154,73 +147,218 @@ void Model::loadTransitionRelation(Minisat::Solver & slv, bool primeConstraints)
       sslv->addClause(~f, platch);
     }
     sslv->eliminate(true);
+    // flatten the simplified context
+    trVars = (size_t) sslv->nVars();
+    trClauses.assign(1, 0);
+    for (Minisat::ClauseIterator c = sslv->clausesBegin(); 
+         c != sslv->clausesEnd(); ++c) {
+      const Minisat::Clause & cls = *c;
+      for (int i = 0; i < cls.size(); ++i)
+        trLits.push_back(cls[i]);
+      trClauses.push_back((uint32_t) trLits.size());
+    }
+    for (Minisat::TrailIterator c = sslv->trailBegin(); 
+         c != sslv->trailEnd(); ++c)
+      trUnits.push_back(*c);
+    delete sslv;
+    if (!trCacheDir.empty()) writeTRCache();
   }
-  // load the clauses from the simplified context
-  while (slv.nVars() < sslv->nVars()) slv.newVar();
-  for (Minisat::ClauseIterator c = sslv->clausesBegin(); 
-       c != sslv->clausesEnd(); ++c) {
-    const Minisat::Clause & cls = *c;
-    Minisat::vec<Minisat::Lit> cls_;
-    for (int i = 0; i < cls.size(); ++i)
-      cls_.push(cls[i]);
-    slv.addClause_(cls_);
+  // load the flattened clauses; Solver::addClause_() may modify its
+  // argument, so they pass through one reused buffer
+  while (slv.nVars() < (int) trVars) slv.newVar();
+  Minisat::vec<Minisat::Lit> cls;
+  for (size_t i = 0; i+1 < trClauses.size(); ++i) {
+    cls.clear();
+    for (uint32_t j = trClauses[i]; j < trClauses[i+1]; ++j)
+      cls.push(trLits[j]);
+    slv.addClause_(cls);
   }
-  for (Minisat::TrailIterator c = sslv->trailBegin(); 
-       c != sslv->trailEnd(); ++c)
-    slv.addClause(*c);
+  for (LitVec::const_iterator i = trUnits.begin(); i != trUnits.end(); ++i)
+    slv.addClause(*i);
+  slv.addClause(~_error);
   if (primeConstraints)
     for (LitVec::const_iterator i = constraints.begin(); 
          i != constraints.end(); ++i)
       slv.addClause(primeLit(*i));
 }
 
-void Model::loadInitialCondition(Minisat::Solver & slv) const {
+void Model::loadInitialCondition(Minisat::Solver & slv, 
+                                 Minisat::Lit act) const {
   slv.addClause(btrue());
   for (LitVec::const_iterator i = init.begin(); i != init.end(); ++i)
-    slv.addClause(*i);
+    if (act == Minisat::lit_Undef)
+      slv.addClause(*i);
+    else
+      slv.addClause(~act, *i);
   if (constraints.empty())
     return;
   // impose invariant constraints on initial states (AIGER 1.9)
-  LitSet require;
-  require.insert(constraints.begin(), constraints.end());
   for (AigVec::const_reverse_iterator i = aig.rbegin(); i != aig.rend(); ++i) {
     // skip if this (*i) is not required
-    if (require.find(i->lhs) == require.end() 
-        && require.find(~i->lhs) == require.end())
-      continue;
+    if (!inCone(constraintCone, i->lhs)) continue;
     // encode into CNF
     slv.addClause(~i->lhs, i->rhs0);
     slv.addClause(~i->lhs, i->rhs1);
     slv.addClause(~i->rhs0, ~i->rhs1, i->lhs);
-    // require arguments
-    require.insert(i->rhs0);
-    require.insert(i->rhs1);
   }
   for (LitVec::const_iterator i = constraints.begin(); 
        i != constraints.end(); ++i)
-    slv.addClause(*i);
+    if (act == Minisat::lit_Undef)
+      slv.addClause(*i);
+    else
+      slv.addClause(~act, *i);
 }
 
-void Model::loadError(Minisat::Solver & slv) const {
-  LitSet require;  // unprimed formulas
-  require.insert(_error);
+void Model::loadError(Minisat::Solver & slv) {
+  Cone & require = errorCones[property];  // unprimed formulas
+  if (require.empty())
+    markCone(LitVec(1, _error), require);
   // traverse AIG backward
   for (AigVec::const_reverse_iterator i = aig.rbegin(); i != aig.rend(); ++i) {
     // skip if this row is not required
-    if (require.find(i->lhs) == require.end() 
-        && require.find(~i->lhs) == require.end())
-      continue;
+    if (!inCone(require, i->lhs)) continue;
     // encode into CNF
     slv.addClause(~i->lhs, i->rhs0);
     slv.addClause(~i->lhs, i->rhs1);
     slv.addClause(~i->rhs0, ~i->rhs1, i->lhs);
-    // require arguments
-    require.insert(i->rhs0);
-    require.insert(i->rhs1);
   }
 }
 
+// The AIG is topologically ordered, so one backward pass suffices.
+void Model::markCone(const LitVec & roots, Cone & cone) const {
+  cone.assign(primes, false);
+  for (LitVec::const_iterator i = roots.begin(); i != roots.end(); ++i)
+    cone[(size_t) Minisat::var(*i)] = true;
+  for (AigVec::const_reverse_iterator i = aig.rbegin(); i != aig.rend(); ++i)
+    if (inCone(cone, i->lhs)) {
+      cone[(size_t) Minisat::var(i->rhs0)] = true;
+      cone[(size_t) Minisat::var(i->rhs1)] = true;
+    }
+}
+
+// FNV-1a over the variable layout, the AND table, and the initial
+// condition, constraints, next-state functions, and errors.
+uint64_t Model::structuralHash() const {
+  vector<uint32_t> words;
+  words.push_back(2);  // cache format version
+  words.push_back((uint32_t) inputs);
+  words.push_back((uint32_t) latches);
+  words.push_back((uint32_t) reps);
+  words.push_back((uint32_t) primes);
+  for (AigVec::const_iterator i = aig.begin(); i != aig.end(); ++i) {
+    words.push_back((uint32_t) Minisat::toInt(i->lhs));
+    words.push_back((uint32_t) Minisat::toInt(i->rhs0));
+    words.push_back((uint32_t) Minisat::toInt(i->rhs1));
+  }
+  const LitVec * sections[] = { &init, &constraints, &nextStateFns, &errors };
+  for (size_t j = 0; j < 4; ++j) {
+    words.push_back((uint32_t) sections[j]->size());
+    for (LitVec::const_iterator i = sections[j]->begin(); 
+         i != sections[j]->end(); ++i)
+      words.push_back((uint32_t) Minisat::toInt(*i));
+  }
+  uint64_t h = 14695981039346656037ULL;
+  for (vector<uint32_t>::const_iterator i = words.begin(); i != words.end(); ++i) {
+    h ^= *i;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+string Model::trCacheFile() const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.tr", 
+           (unsigned long long) structuralHash());
+  return trCacheDir + name;
+}
+
+// A cache entry is a sequence of 32-bit words: the ANDs in the order
+// in which their primed versions were created, the number of
+// variables, and the flattened TR (literals, clause end offsets, and
+// units), each list preceded by its length.
+
+static bool readWords(istream & in, vector<uint32_t> & words) {
+  uint32_t n;
+  if (!in.read((char *) &n, sizeof(n))) return false;
+  words.resize(n);
+  return n == 0 || in.read((char *) &words[0], n * sizeof(uint32_t));
+}
+
+static void writeWords(ostream & out, const vector<uint32_t> & words) {
+  uint32_t n = (uint32_t) words.size();
+  out.write((const char *) &n, sizeof(n));
+  if (n) out.write((const char *) &words[0], n * sizeof(uint32_t));
+}
+
+// Loads the flattened TR from the cache, if it has an entry for this
+// model.
+bool Model::readTRCache() {
+  ifstream in(trCacheFile().c_str(), ios::binary);
+  uint64_t h;
+  vector<uint32_t> ands, nvars, lits, ends, units;
+  if (!in.read((char *) &h, sizeof(h)) || h != structuralHash()
+      || !readWords(in, ands) || !readWords(in, nvars) || nvars.size() != 1
+      || !readWords(in, lits) || !readWords(in, ends) 
+      || !readWords(in, units))
+    return false;
+  // validate before creating any primed variables
+  for (size_t i = 0; i < ands.size(); ++i)
+    if (ands[i] < reps || ands[i] >= primes) return false;
+  for (size_t i = 0; i < ends.size(); ++i)
+    if (ends[i] > lits.size() || (i > 0 && ends[i] < ends[i-1])) 
+      return false;
+  for (size_t i = 0; i < lits.size(); ++i)
+    if (lits[i] >= 2 * nvars[0]) return false;
+  for (size_t i = 0; i < units.size(); ++i)
+    if (units[i] >= 2 * nvars[0]) return false;
+  // recreate the primed ANDs in the original order
+  for (size_t i = 0; i < ands.size(); ++i)
+    primeVar(vars[ands[i]]);
+  if (vars.size() != nvars[0]) return false;
+
+  trClauses.assign(1, 0);
+  trClauses.insert(trClauses.end(), ends.begin(), ends.end());
+  for (size_t i = 0; i < lits.size(); ++i)
+    trLits.push_back(Minisat::toLit((int) lits[i]));
+  for (size_t i = 0; i < units.size(); ++i)
+    trUnits.push_back(Minisat::toLit((int) units[i]));
+  trVars = vars.size();
+  return true;
+}
+
+// Failing to write the cache is not an error.
+void Model::writeTRCache() const {
+  vector<pair<size_t, size_t> > primed;  // (primed, AND) indices
+  for (IndexMap::const_iterator i = primedAnds.begin(); 
+       i != primedAnds.end(); ++i)
+    primed.push_back(make_pair(i->second, i->first));
+  sort(primed.begin(), primed.end());
+  vector<uint32_t> ands, nvars(1, (uint32_t) trVars), lits, units;
+  for (size_t i = 0; i < primed.size(); ++i)
+    ands.push_back((uint32_t) primed[i].second);
+  for (LitVec::const_iterator i = trLits.begin(); i != trLits.end(); ++i)
+    lits.push_back((uint32_t) Minisat::toInt(*i));
+  vector<uint32_t> ends(trClauses.begin()+1, trClauses.end());
+  for (LitVec::const_iterator i = trUnits.begin(); i != trUnits.end(); ++i)
+    units.push_back((uint32_t) Minisat::toInt(*i));
+  // write to a temporary file first so that readers never see a
+  // partial entry
+  string name = trCacheFile(), tmp = name + ".tmp";
+  ofstream out(tmp.c_str(), ios::binary);
+  uint64_t h = structuralHash();
+  out.write((const char *) &h, sizeof(h));
+  writeWords(out, ands);
+  writeWords(out, nvars);
+  writeWords(out, lits);
+  writeWords(out, ends);
+  writeWords(out, units);
+  out.close();
+  if (out) rename(tmp.c_str(), name.c_str());
+  else remove(tmp.c_str());
+}
+
 bool Model::isInitial(const LitVec & latches) {
+  std::lock_guard<std::mutex> lock(initMutex);
   if (constraints.empty()) {
     // an intersection check (AIGER 1.9 w/o invariant constraints)
     if (initLits.empty())
@@ -244,9 +382,33 @@ bool Model::isInitial(const LitVec & latches) {
   }
 }
 
-// Creates a named variable.
+// Minisat does not report its memory use, so count 4 bytes per
+// literal, 20 per original clause (header and two watchers), 24 per
+// learnt clause (which also has an activity), and 72 per variable
+// (assignment, activity, reason, level, heap, trail, watch lists).
+size_t Model::solverBytes(const Minisat::Solver & slv) {
+  return 4 * (size_t) (slv.clauses_literals + slv.learnts_literals)
+    + 20 * (size_t) slv.nClauses() + 24 * (size_t) slv.nLearnts()
+    + 72 * (size_t) slv.nVars();
+}
+
+size_t Model::bytes() const {
+  size_t b = vars.capacity() * sizeof(Var);
+  for (VarVec::const_iterator i = vars.begin(); i != vars.end(); ++i)
+    b += i->nameBytes();
+  b += aig.capacity() * sizeof(AigRow)
+    + primedAnds.size() * 4 * sizeof(size_t)  // node and bucket
+    + (trLits.capacity() + trUnits.capacity()) * sizeof(Minisat::Lit)
+    + trClauses.capacity() * sizeof(uint32_t)
+    + initLits.size() * 4 * sizeof(void *);   // tree node
+  std::lock_guard<std::mutex> lock(initMutex);
+  if (inits) b += solverBytes(*inits);
+  return b;
+}
+
+// Creates a named variable with the given index.
 Var var(const aiger_symbol * syms, size_t i, const char prefix, 
-        bool prime = false)
+        Minisat::Var index, bool prime = false)
 {
   const aiger_symbol & sym = syms[i];
   stringstream ss;
@@ -256,22 +418,24 @@ Var var(const aiger_symbol * syms, size_t i, const char prefix,
     ss << prefix << i;
   if (prime) 
     ss << "'";
-  return Var(ss.str());
+  return Var(ss.str(), index);
 }
 
 Minisat::Lit lit(const VarVec & vars, unsigned int l) {
   return vars[l>>1].lit(aiger_sign(l));
 }
 
-Model * modelFromAiger(aiger * aig, unsigned int propertyIndex) {
-  VarVec vars(1, Var("false"));
+// Creates a model of the given properties, which index the bad
+// section, or the output section if there are no bad states.
+Model * modelFromAiger(aiger * aig, const vector<unsigned int> & properties) {
+  VarVec vars(1, Var("false", 0));
   LitVec init, constraints, nextStateFns;
 
   // declare primary inputs and latches
   for (size_t i = 0; i < aig->num_inputs; ++i)
-    vars.push_back(var(aig->inputs, i, 'i'));
+    vars.push_back(var(aig->inputs, i, 'i', (Minisat::Var) vars.size()));
   for (size_t i = 0; i < aig->num_latches; ++i)
-    vars.push_back(var(aig->latches, i, 'l'));
+    vars.push_back(var(aig->latches, i, 'l', (Minisat::Var) vars.size()));
 
   // the AND section
   AigVec aigv;
@@ -279,7 +443,7 @@ Model * modelFromAiger(aiger * aig, unsigned int propertyIndex) {
     // 1. create a representative
     stringstream ss;
     ss << 'r' << i;
-    vars.push_back(Var(ss.str()));
+    vars.push_back(Var(ss.str(), (Minisat::Var) vars.size()));
     const Var & rep = vars.back();
     // 2. obtain arguments of AND as lits
     Minisat::Lit l0 = lit(vars, aig->ands[i].rhs0);
@@ -303,20 +467,38 @@ Model * modelFromAiger(aiger * aig, unsigned int propertyIndex) {
   for (size_t i = 0; i < aig->num_constraints; ++i)
     constraints.push_back(lit(vars, aig->constraints[i].lit));
 
+  // acquire errors
+  LitVec errs;
+  for (vector<unsigned int>::const_iterator i = properties.begin();
+       i != properties.end(); ++i)
+    errs.push_back(aig->num_bad > 0 
+                   ? lit(vars, aig->bad[*i].lit) 
+                   : lit(vars, aig->outputs[*i].lit));
+
+  size_t inputs = 1, latches = inputs + aig->num_inputs;
+  return new Model(vars, 
+                   inputs, latches, latches + aig->num_latches,
+                   init, constraints, nextStateFns, errs, aigv);
+}
+
+Model * modelFromAiger(aiger * aig, unsigned int propertyIndex) {
   // acquire error from given propertyIndex
   if ((aig->num_bad > 0 && aig->num_bad <= propertyIndex)
       || (aig->num_outputs > 0 && aig->num_outputs <= propertyIndex)) {
     cout << "Bad property index specified." << endl;
     return 0;
   }
-  Minisat::Lit err = 
-    aig->num_bad > 0 
-    ? lit(vars, aig->bad[propertyIndex].lit) 
-    : lit(vars, aig->outputs[propertyIndex].lit);
+  return modelFromAiger(aig, vector<unsigned int>(1, propertyIndex));
+}
 
-  size_t offset = 0;
-  return new Model(vars, 
-                   offset += 1, offset += aig->num_inputs, 
-                   offset + aig->num_latches,
-                   init, constraints, nextStateFns, err, aigv);
+Model * multiModelFromAiger(aiger * aig) {
+  unsigned int n = aig->num_bad > 0 ? aig->num_bad : aig->num_outputs;
+  if (n == 0) {
+    cout << "No property specified." << endl;
+    return 0;
+  }
+  vector<unsigned int> properties;
+  for (unsigned int i = 0; i < n; ++i)
+    properties.push_back(i);
+  return modelFromAiger(aig, properties);
 }
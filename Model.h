@@ -25,7 +25,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define MODEL_H_INCLUDED
 
 #include <algorithm>
+#include <mutex>
 #include <set>
+#include <stdint.h>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
@@ -51,10 +53,12 @@ typedef vector<AigRow> AigVec;
 typedef vector<Minisat::Lit> LitVec;
 
 // A lightweight wrapper around Minisat::Var that includes a name.
+// Variables are numbered per Model: the Var at position i of a
+// Model's variable vector has index i.
 class Var {
 public:
-  Var(const string name) {
-    _var = gvi++;
+  Var(const string name, Minisat::Var index) {
+    _var = index;
     _name = name;
   }
   size_t index() const { return (size_t) _var; }
@@ -63,9 +67,10 @@ public:
     return Minisat::mkLit(_var, neg);
   }
   string name() const { return _name; }
+  size_t nameBytes() const { return _name.capacity(); }
 private:
-  static Minisat::Var gvi;  // aligned with solvers
-  Minisat::Var _var;        // corresponding Minisat::Var in *any* solver
+  Minisat::Var _var;  // corresponding Minisat::Var in any of the
+                      // Model's solvers
   string _name;
 };
 
@@ -89,26 +94,31 @@ class Model {
 public:
   // Construct a model from a vector of variables, indices indicating
   // divisions between variable types, constraints, next-state
-  // functions, the error, and the AND table, closely reflecting the
-  // AIGER format.  Easier to use "modelFromAiger()", below.
+  // functions, the errors (one per property), and the AND table,
+  // closely reflecting the AIGER format.  The first property is
+  // selected.  Easier to use "modelFromAiger()", below.
   Model(vector<Var> _vars, 
         size_t _inputs, size_t _latches, size_t _reps, 
         LitVec _init, LitVec _constraints, LitVec _nextStateFns, 
-        Minisat::Lit _err, AigVec _aig) :
+        LitVec _errs, AigVec _aig) :
     vars(_vars), 
     inputs(_inputs), latches(_latches), reps(_reps),
     primes(_vars.size()), primesUnlocked(true), aig(_aig),
     init(_init), constraints(_constraints), nextStateFns(_nextStateFns),
-    _error(_err), inits(NULL), sslv(NULL)
+    errors(_errs), _error(_errs[0]), property(0), 
+    errorCones(_errs.size()), inits(NULL), trVars(0)
   {
     // create primed inputs and latches in known region of vars
     for (size_t i = inputs; i < reps; ++i) {
       stringstream ss;
       ss << vars[i].name() << "'";
-      vars.push_back(Var(ss.str()));
+      vars.push_back(Var(ss.str(), (Minisat::Var) vars.size()));
     }
-    // same with primed error
-    _primedError = primeLit(_error); // make the bad state to the next state
+    // same with primed errors
+    for (LitVec::const_iterator i = errors.begin(); i != errors.end(); ++i)
+      primedErrors.push_back(primeLit(*i)); // make the bad state to the next state
+    _primedError = primedErrors[0];
+    markCone(constraints, constraintCone);
     // same with primed constraints
     for (LitVec::const_iterator i = constraints.begin(); 
          i != constraints.end(); ++i)
@@ -176,6 +186,11 @@ public:
     return vars.begin()+reps; 
   }
 
+  // The AND section of the AIGER spec, over the unprimed variables,
+  // whose indices are below numUnprimedVars().
+  const AigVec & andGates() const { return aig; }
+  size_t numUnprimedVars() const { return primes; }
+
   // Next-state function for given latch.
   Minisat::Lit nextStateFn(const Var & latch) const {
     assert (latch.index() >= latches && latch.index() < reps);
@@ -186,6 +201,19 @@ public:
   Minisat::Lit error() const { return _error; }
   Minisat::Lit primedError() const { return _primedError; }
 
+  // The properties of the model: selecting one makes error() and
+  // primedError(), and the negation of the error asserted by
+  // loadTransitionRelation(), refer to it.  All properties share the
+  // simplified TR.  Do not select a property while solvers loaded
+  // from the model are in use.
+  size_t numProperties() const { return errors.size(); }
+  void setProperty(size_t i) {
+    assert (i < errors.size());
+    property = i;
+    _error = errors[i];
+    _primedError = primedErrors[i];
+  }
+
   // Invariant constraints
   const LitVec & invariantConstraints() { return constraints; }
 
@@ -201,16 +229,35 @@ public:
   // !primeConstraints.
   void loadTransitionRelation(Minisat::Solver & slv, 
                               bool primeConstraints = true);
-  // Loads the initial condition into the solver.
-  void loadInitialCondition(Minisat::Solver & slv) const;
+  // Makes loadTransitionRelation() look for the simplified TR in the
+  // given directory before building it, and save it there after
+  // building it.  Entries are keyed by a structural hash of the AIG,
+  // the properties and the constraints.
+  void setTRCacheDir(const string & dir) { trCacheDir = dir; }
+  // A hash of the AIG, the properties, and the constraints, which
+  // identifies the model across runs.
+  uint64_t structuralHash() const;
+  // Loads the initial condition into the solver, guarded by act if
+  // it is given: then the initial condition holds only under the
+  // assumption act.
+  void loadInitialCondition(Minisat::Solver & slv, 
+                            Minisat::Lit act = Minisat::lit_Undef) const;
   // Loads the error into the solver, which is only necessary for the
-  // 0-step base case of IC3.
-  void loadError(Minisat::Solver & slv) const;
+  // 0-step base case of IC3.  Unlike the other loaders, it must not
+  // be called concurrently.
+  void loadError(Minisat::Solver & slv);
 
   // Use this method to allow the Model to decide how best to decide
-  // if a cube has an initial state.
+  // if a cube has an initial state.  It may be called from several
+  // threads at once.
   bool isInitial(const LitVec & latches);
 
+  // Estimated heap memory, in bytes, held by the Model (variables and
+  // their names, the AIG, the simplified TR, and the initial-state
+  // solver), or by a Solver (from its clause and variable counts).
+  size_t bytes() const;
+  static size_t solverBytes(const Minisat::Solver & slv);
+
 private:
   VarVec vars;
   const size_t inputs, latches, reps, primes;
@@ -221,8 +268,20 @@ private:
 
   const AigVec aig;
   const LitVec init, constraints, nextStateFns;
-  const Minisat::Lit _error;
-  Minisat::Lit _primedError;
+  const LitVec errors;
+  LitVec primedErrors;
+  Minisat::Lit _error, _primedError;
+  size_t property;
+
+  // Cones of influence, marked by (unprimed) variable index: the
+  // loaders encode just the AND rows whose outputs are marked.
+  typedef vector<bool> Cone;
+  void markCone(const LitVec & roots, Cone & cone) const;
+  static bool inCone(const Cone & cone, Minisat::Lit lit) {
+    return cone[(size_t) Minisat::var(lit)];
+  }
+  Cone constraintCone;
+  vector<Cone> errorCones;  // per property, computed on demand
 
   typedef size_t TRMapKey;
   typedef unordered_map<TRMapKey, Minisat::SimpSolver *> TRMap;
@@ -230,12 +289,24 @@ private:
 
   Minisat::Solver * inits;
   LitSet initLits;
+  mutable std::mutex initMutex;  // guards inits and initLits
+
+  // The simplified TR, flattened: clause i consists of trLits
+  // [trClauses[i], trClauses[i+1]); unit clauses are in trUnits.
+  size_t trVars;  // 0 until the TR has been built
+  LitVec trLits, trUnits;
+  vector<uint32_t> trClauses;
 
-  Minisat::SimpSolver * sslv;
+  string trCacheDir;
+  string trCacheFile() const;
+  bool readTRCache();
+  void writeTRCache() const;
 
 };
 
 // The easiest way to create a model.
 Model * modelFromAiger(aiger * aig, unsigned int propertyIndex);
+// Creates a model with all of the AIGER file's properties, in order.
+Model * multiModelFromAiger(aiger * aig);
 
 #endif
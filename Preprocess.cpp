@@ -0,0 +1,340 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <stdint.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "Preprocess.h"
+
+using namespace std;
+
+namespace {
+
+  // A structurally hashed AIG under construction.  As in AIGER,
+  // literal 2n+s is node n, complemented if s; node 0 is false.
+  class Strash {
+  public:
+    Strash() : nodes(1) {}
+
+    unsigned input() {
+      nodes.push_back(Node());
+      return 2 * (unsigned) (nodes.size()-1);
+    }
+    unsigned conj(unsigned a, unsigned b) {
+      if (a > b) swap(a, b);
+      if (a == 0 || a == (b ^ 1)) return 0;
+      if (a == 1 || a == b) return b;
+      uint64_t key = ((uint64_t) a << 32) | b;
+      unordered_map<uint64_t, unsigned>::const_iterator i = table.find(key);
+      if (i != table.end()) return i->second;
+      Node n;
+      n.gate = true;
+      n.a = a;
+      n.b = b;
+      nodes.push_back(n);
+      unsigned lit = 2 * (unsigned) (nodes.size()-1);
+      table[key] = lit;
+      return lit;
+    }
+
+    struct Node {
+      Node() : gate(false), a(0), b(0) {}
+      bool gate;
+      unsigned a, b;
+    };
+    vector<Node> nodes;  // topologically ordered
+
+  private:
+    unordered_map<uint64_t, unsigned> table;
+  };
+
+  const unsigned Const = (unsigned) -1;
+
+  // Latch classes: latch j is equal to latch rep[j] (a
+  // representative, with rep[rep[j]] == rep[j]), or to false if
+  // rep[j] == Const, complemented if pol[j].
+  struct Classes {
+    vector<unsigned> rep, pol;
+  };
+
+  // Rebuilds aig in s, substituting each latch by its class; lits[v]
+  // is the literal of original variable v.  Representatives and
+  // inputs become inputs of s.
+  void build(const aiger * aig, const Classes & cls, Strash & s,
+             vector<unsigned> & lits)
+  {
+    lits.assign(aig->maxvar+1, 0);
+    for (unsigned i = 0; i < aig->num_inputs; ++i)
+      lits[aiger_lit2var(aig->inputs[i].lit)] = s.input();
+    for (unsigned j = 0; j < aig->num_latches; ++j)
+      if (cls.rep[j] == j)
+        lits[aiger_lit2var(aig->latches[j].lit)] = s.input();
+    for (unsigned j = 0; j < aig->num_latches; ++j) {
+      unsigned r = cls.rep[j];
+      lits[aiger_lit2var(aig->latches[j].lit)] = 
+        (r == Const ? 0 : lits[aiger_lit2var(aig->latches[r].lit)]) 
+        ^ cls.pol[j];
+    }
+    for (unsigned i = 0; i < aig->num_ands; ++i) {
+      const aiger_and & a = aig->ands[i];
+      lits[aiger_lit2var(a.lhs)] = 
+        s.conj(lits[aiger_lit2var(a.rhs0)] ^ aiger_sign(a.rhs0),
+               lits[aiger_lit2var(a.rhs1)] ^ aiger_sign(a.rhs1));
+    }
+  }
+
+  unsigned mapLit(const vector<unsigned> & lits, unsigned l) {
+    return lits[aiger_lit2var(l)] ^ aiger_sign(l);
+  }
+
+  // Names an input or latch after the original.
+  string name(const aiger_symbol & sym, char prefix, unsigned i) {
+    if (sym.name) return sym.name;
+    stringstream ss;
+    ss << prefix << i;
+    return ss.str();
+  }
+
+}
+
+aiger * preprocess(aiger * aig, const vector<unsigned> & properties,
+                   AigMap & map)
+{
+  unsigned nl = aig->num_latches;
+
+  // Start from the coarsest classes consistent with the initial
+  // states: every initialized latch is assumed constant at its
+  // initial value.  Then split classes until the next-state function
+  // of each latch, under the substitution, agrees with its class's.
+  Classes cls;
+  cls.rep.resize(nl);
+  cls.pol.resize(nl);
+  for (unsigned j = 0; j < nl; ++j) {
+    unsigned r = aig->latches[j].reset;
+    cls.rep[j] = r < 2 ? Const : j;
+    cls.pol[j] = r < 2 ? r : 0;
+  }
+  Strash s;
+  vector<unsigned> lits;
+  for (bool changed = true; changed; ) {
+    changed = false;
+    s = Strash();
+    build(aig, cls, s, lits);
+    // next-state function of each latch, relative to its class
+    vector<unsigned> next(nl);
+    for (unsigned j = 0; j < nl; ++j)
+      next[j] = mapLit(lits, aig->latches[j].next) ^ cls.pol[j];
+    // members that disagree with their class form new classes, one
+    // per (class, next-state function)
+    Classes split = cls;
+    unordered_map<uint64_t, unsigned> newRep;
+    for (unsigned j = 0; j < nl; ++j) {
+      unsigned r = cls.rep[j];
+      if (next[j] == (r == Const ? 0 : next[r])) continue;
+      uint64_t key = ((uint64_t) r << 32) | next[j];
+      unordered_map<uint64_t, unsigned>::const_iterator i = newRep.find(key);
+      if (i == newRep.end()) {
+        newRep[key] = j;
+        split.rep[j] = j;
+        split.pol[j] = 0;
+      }
+      else {
+        split.rep[j] = i->second;
+        split.pol[j] = cls.pol[j] ^ cls.pol[i->second];
+      }
+      changed = true;
+    }
+    cls = split;
+  }
+
+  // cone of influence of the properties and constraints
+  vector<unsigned> roots;
+  for (vector<unsigned>::const_iterator i = properties.begin(); 
+       i != properties.end(); ++i)
+    roots.push_back(mapLit(lits, aig->num_bad > 0 ? aig->bad[*i].lit 
+                                                  : aig->outputs[*i].lit));
+  for (unsigned i = 0; i < aig->num_constraints; ++i)
+    roots.push_back(mapLit(lits, aig->constraints[i].lit));
+  vector<int> latchOfNode(s.nodes.size(), -1);
+  for (unsigned j = 0; j < nl; ++j)
+    if (cls.rep[j] == j)
+      latchOfNode[mapLit(lits, aig->latches[j].lit) >> 1] = (int) j;
+  vector<bool> inCone(s.nodes.size(), false);
+  vector<unsigned> stack;
+  for (vector<unsigned>::const_iterator i = roots.begin(); i != roots.end(); ++i)
+    stack.push_back(*i >> 1);
+  while (!stack.empty()) {
+    unsigned n = stack.back();
+    stack.pop_back();
+    if (n == 0 || inCone[n]) continue;
+    inCone[n] = true;
+    const Strash::Node & nd = s.nodes[n];
+    if (nd.gate) {
+      stack.push_back(nd.a >> 1);
+      stack.push_back(nd.b >> 1);
+    }
+    else if (latchOfNode[n] >= 0)
+      stack.push_back(mapLit(lits, aig->latches[latchOfNode[n]].next) >> 1);
+  }
+
+  // number the remaining inputs, latches, and ANDs in AIGER order
+  aiger * pre = aiger_init();
+  vector<unsigned> newLit(s.nodes.size(), 0);
+  unsigned v = 0;
+  for (unsigned i = 0; i < aig->num_inputs; ++i) {
+    unsigned n = mapLit(lits, aig->inputs[i].lit) >> 1;
+    if (!inCone[n]) continue;
+    newLit[n] = aiger_var2lit(++v);
+    aiger_add_input(pre, newLit[n], name(aig->inputs[i], 'i', i).c_str());
+  }
+  map.preLatchBase = v+1;
+  vector<unsigned> latches;  // kept representatives
+  for (unsigned j = 0; j < nl; ++j) {
+    if (cls.rep[j] != j) continue;
+    unsigned n = mapLit(lits, aig->latches[j].lit) >> 1;
+    if (!inCone[n]) continue;
+    newLit[n] = aiger_var2lit(++v);
+    latches.push_back(j);
+  }
+  for (size_t n = 1; n < s.nodes.size(); ++n)
+    if (inCone[n] && s.nodes[n].gate)
+      newLit[n] = aiger_var2lit(++v);
+  // literals of s to literals of pre
+  vector<unsigned> preLit(2 * s.nodes.size());
+  for (size_t n = 0; n < s.nodes.size(); ++n) {
+    preLit[2*n] = newLit[n];
+    preLit[2*n+1] = newLit[n] ^ 1;
+  }
+  for (size_t i = 0; i < latches.size(); ++i) {
+    unsigned j = latches[i];
+    unsigned l = preLit[mapLit(lits, aig->latches[j].lit)];
+    aiger_add_latch(pre, l, preLit[mapLit(lits, aig->latches[j].next)],
+                    name(aig->latches[j], 'l', j).c_str());
+    unsigned r = aig->latches[j].reset;
+    aiger_add_reset(pre, l, r < 2 ? r : l);
+  }
+  for (size_t n = 1; n < s.nodes.size(); ++n)
+    if (inCone[n] && s.nodes[n].gate)
+      aiger_add_and(pre, newLit[n], preLit[s.nodes[n].a], preLit[s.nodes[n].b]);
+  for (size_t i = 0; i < properties.size(); ++i)
+    aiger_add_bad(pre, preLit[roots[i]], NULL);
+  for (size_t i = properties.size(); i < roots.size(); ++i)
+    aiger_add_constraint(pre, preLit[roots[i]], NULL);
+
+  // record how the latches relate
+  map.origLatches.clear();
+  map.toPre.clear();
+  map.equiv.clear();
+  map.toOrig.clear();
+  map.names.clear();
+  for (unsigned j = 0; j < nl; ++j) {
+    unsigned r = cls.rep[j];
+    map.origLatches.push_back(aig->latches[j].lit);
+    map.names.push_back(name(aig->latches[j], 'l', j));
+    if (r == Const) {
+      map.toPre.push_back(cls.pol[j]);
+      map.equiv.push_back(cls.pol[j]);
+    }
+    else {
+      unsigned n = mapLit(lits, aig->latches[r].lit) >> 1;
+      map.toPre.push_back(inCone[n] ? newLit[n] ^ cls.pol[j] : AigMap::Removed);
+      map.equiv.push_back(aig->latches[r].lit ^ cls.pol[j]);
+    }
+  }
+  for (size_t i = 0; i < latches.size(); ++i)
+    map.toOrig.push_back(aig->latches[latches[i]].lit);
+  return pre;
+}
+
+bool AigMap::toPreprocessed(vector<int> & cube) const {
+  vector<int> out;
+  for (vector<int>::const_iterator i = cube.begin(); i != cube.end(); ++i) {
+    vector<unsigned>::const_iterator j = 
+      find(origLatches.begin(), origLatches.end(), aiger_strip(*i));
+    if (j == origLatches.end()) return false;
+    unsigned l = toPre[j - origLatches.begin()];
+    if (l == Removed) return false;
+    l ^= aiger_sign(*i);
+    if (l == aiger_false) return false;  // the cube is empty
+    if (l != aiger_true) out.push_back((int) l);
+  }
+  sort(out.begin(), out.end());
+  out.erase(unique(out.begin(), out.end()), out.end());
+  for (size_t i = 1; i < out.size(); ++i)
+    if (out[i] == (out[i-1] ^ 1)) return false;
+  if (out.empty()) return false;
+  cube.swap(out);
+  return true;
+}
+
+void AigMap::toOriginal(vector<int> & cube) const {
+  for (vector<int>::iterator i = cube.begin(); i != cube.end(); ++i)
+    *i = (int) (toOrig[aiger_lit2var(*i) - preLatchBase] ^ aiger_sign(*i));
+}
+
+void AigMap::equivalenceCubes(vector<vector<int> > & out) const {
+  for (size_t j = 0; j < origLatches.size(); ++j) {
+    unsigned l = origLatches[j], e = equiv[j];
+    if (e < 2)
+      // l == e
+      out.push_back(vector<int>(1, (int) (l ^ e)));
+    else if (e != l) {
+      // l == e
+      vector<int> c(2);
+      c[0] = (int) l;
+      c[1] = (int) (e ^ 1);
+      out.push_back(c);
+      c[0] = (int) (l ^ 1);
+      c[1] = (int) e;
+      out.push_back(c);
+    }
+  }
+}
+
+void AigMap::stateToOriginal(vector<int> & state) const {
+  vector<int> sorted(state);
+  sort(sorted.begin(), sorted.end());
+  state.clear();
+  for (size_t j = 0; j < origLatches.size(); ++j) {
+    unsigned l = toPre[j];
+    if (l == Removed) continue;
+    if (l < 2) {
+      state.push_back((int) (origLatches[j] ^ l ^ 1));
+      continue;
+    }
+    if (binary_search(sorted.begin(), sorted.end(), (int) l))
+      state.push_back((int) origLatches[j]);
+    else if (binary_search(sorted.begin(), sorted.end(), (int) (l ^ 1)))
+      state.push_back((int) (origLatches[j] ^ 1));
+  }
+}
+
+const string & AigMap::latchName(int lit) const {
+  size_t j = find(origLatches.begin(), origLatches.end(), 
+                  aiger_strip(lit)) - origLatches.begin();
+  return names.at(j);
+}
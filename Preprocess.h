@@ -0,0 +1,92 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#ifndef PREPROCESS_H_INCLUDED
+#define PREPROCESS_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "aiger.h"
+}
+
+// Relates the latches of a preprocessed AIG to those of the original.
+// Cubes are vectors of AIGER literals over latches, as in ClauseBuf
+// files and inv.cnf.
+class AigMap {
+public:
+  // Rewrites a cube over the original latches into one over the
+  // preprocessed latches.  Returns false if it has no counterpart:
+  // if it is inconsistent with the latches found to be constant or
+  // equivalent, or if it mentions a latch outside the cone of
+  // influence.
+  bool toPreprocessed(std::vector<int> & cube) const;
+  // Rewrites a cube over the preprocessed latches into one over the
+  // original latches.
+  void toOriginal(std::vector<int> & cube) const;
+  // Appends cubes whose negations state, over the original latches,
+  // all of the constants and equivalences found by preprocessing,
+  // including those of latches outside the cone of influence: they
+  // were proved together, so only all of them together are
+  // inductive.  They complete an invariant of the preprocessed AIG to
+  // one of the original.
+  void equivalenceCubes(std::vector<std::vector<int> > & out) const;
+  // Rewrites a state (a cube, possibly partial) over the preprocessed
+  // latches into one over the original latches: a merged latch takes
+  // its representative's value, complemented as needed, and a
+  // constant latch its constant value.  Latches outside the cone of
+  // influence stay unassigned.
+  void stateToOriginal(std::vector<int> & state) const;
+  // The name of the original latch of the given literal.
+  const std::string & latchName(int lit) const;
+
+private:
+  friend aiger * preprocess(aiger *, const std::vector<unsigned> &, AigMap &);
+  static const unsigned Removed = (unsigned) -1;
+  std::vector<unsigned> origLatches;  // original latch literals
+  // Per original latch: its preprocessed AIGER literal (possibly
+  // constant), or Removed.
+  std::vector<unsigned> toPre;
+  // Per original latch: its representative's original literal,
+  // complemented as needed, or 0/1 for a constant.
+  std::vector<unsigned> equiv;
+  // Per preprocessed latch: the original literal.
+  std::vector<unsigned> toOrig;
+  std::vector<std::string> names;  // per original latch
+  unsigned preLatchBase;  // variable of the first preprocessed latch
+};
+
+// Returns a simplified copy of aig, with the given properties (indices
+// into the bad section, or the output section if there are no bad
+// states) as its bad section, in order.  The passes are structural
+// hashing with constant folding; sequential constant propagation and
+// merging of latches, as the greatest fixpoint of latch classes whose
+// members agree initially and whose next-state functions agree
+// structurally; and cone-of-influence reduction.  Inputs and latches
+// keep their original names.  The caller resets the result.
+aiger * preprocess(aiger * aig, const std::vector<unsigned> & properties,
+                   AigMap & map);
+
+#endif
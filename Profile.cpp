@@ -0,0 +1,102 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <chrono>
+#include <cstring>
+
+#include "Profile.h"
+
+namespace {
+  const char * phaseNames[NumPhases] = {
+    "other", "strengthen", "block", "lift", "mic", "ctg", "push",
+    "simplify", "recycle", "import"
+  };
+}
+
+Profile::Profile() : queryStart(0) {
+  start = mark = now();
+  stack.push_back(PhOther);
+  memset(phaseNs, 0, sizeof phaseNs);
+  memset(queries, 0, sizeof queries);
+}
+
+uint64_t Profile::now() {
+  return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profile::charge() {
+  uint64_t t = now();
+  phaseNs[stack.back()] += t - mark;
+  mark = t;
+}
+
+void Profile::enter(Phase ph) {
+  charge();
+  stack.push_back(ph);
+}
+
+void Profile::leave() {
+  charge();
+  stack.pop_back();
+}
+
+void Profile::endQuery() {
+  uint64_t ns = now() - queryStart;
+  Queries & q = queries[stack.back()];
+  q.count++;
+  q.ns += ns;
+  size_t b = 0;
+  while (b+1 < Buckets && (ns >> (b+1))) ++b;
+  q.hist[b]++;
+}
+
+void Profile::writeJson(std::ostream & out) {
+  charge();
+  out << "\"elapsed_ns\":" << mark - start;
+  out << ",\"phases\":{";
+  for (size_t i = 0; i < NumPhases; ++i)
+    out << (i ? "," : "") << "\"" << phaseNames[i] << "\":" << phaseNs[i];
+  // histograms are cut after their last non-empty bucket
+  out << "},\"query_latency\":{";
+  bool first = true;
+  for (size_t i = 0; i < NumPhases; ++i) {
+    const Queries & q = queries[i];
+    if (!q.count) continue;
+    out << (first ? "" : ",") << "\"" << phaseNames[i] << "\":{\"count\":"
+        << q.count << ",\"ns\":" << q.ns << ",\"log2_hist\":[";
+    first = false;
+    size_t n = Buckets;
+    while (!q.hist[n-1]) --n;
+    for (size_t b = 0; b < n; ++b)
+      out << (b ? "," : "") << q.hist[b];
+    out << "]}";
+  }
+  out << "},\"levels\":[";
+  for (size_t i = 0; i < levels.size(); ++i)
+    out << (i ? "," : "") << "{\"lemmas\":" << levels[i].lemmas
+        << ",\"pushes\":" << levels[i].pushes
+        << ",\"ctis\":" << levels[i].ctis << "}";
+  out << "]";
+}
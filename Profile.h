@@ -0,0 +1,107 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+// The phases of an IC3 run that a Profile tells apart.  Phases nest
+// (e.g., Ctg within Mic within Block); time is charged to the
+// innermost one.
+enum Phase {
+  PhOther,       // outside any of the following
+  PhStrengthen,  // frontier queries of strengthen()
+  PhBlock,       // proof obligations, less what is listed below
+  PhLift,        // stateOf()
+  PhMic,         // mic(), less ctgDown()
+  PhCtg,         // ctgDown()
+  PhPush,        // clause propagation
+  PhSimplify,    // solver simplify()
+  PhRecycle,     // solver rebuilds
+  PhImport,      // lemmas received from other instances
+  NumPhases
+};
+
+// Fine-grained profile of one IC3 instance, kept with a nanosecond
+// steady clock: time per phase, SAT query latencies per phase (so, by
+// call site) as log2 histograms, and counters per frame level.  It
+// is not thread-safe; only the instance's own thread may update it.
+class Profile {
+public:
+  Profile();
+
+  static uint64_t now();  // ns
+
+  // Makes ph the current phase until the matching leave().
+  void enter(Phase ph);
+  void leave();
+  // Enters a phase for the lifetime of the Scope.
+  class Scope {
+  public:
+    Scope(Profile & _prof, Phase ph) : prof(_prof) { prof.enter(ph); }
+    ~Scope() { prof.leave(); }
+  private:
+    Profile & prof;
+  };
+
+  // Brackets a SAT query, which is attributed to the current phase.
+  void startQuery() { queryStart = now(); }
+  void endQuery();
+
+  void lemma(size_t level) { at(level).lemmas++; }
+  void pushed(size_t level) { at(level).pushes++; }
+  void cti(size_t level) { at(level).ctis++; }
+
+  // Writes the profile as members of a JSON object: "elapsed_ns",
+  // "phases", "query_latency", and "levels".
+  void writeJson(std::ostream & out);
+
+private:
+  static const size_t Buckets = 40;  // [2^b, 2^(b+1)) ns; the last is open
+  struct Queries {
+    uint64_t count, ns;
+    uint64_t hist[Buckets];
+  };
+  struct Level {
+    uint64_t lemmas, pushes, ctis;
+  };
+
+  uint64_t start, mark;    // of the run, and of the last phase change
+  std::vector<Phase> stack;     // of entered phases
+  uint64_t phaseNs[NumPhases];
+  Queries queries[NumPhases];
+  uint64_t queryStart;
+  std::vector<Level> levels;
+
+  void charge();  // charges the time since mark to the current phase
+  Level & at(size_t level) {
+    if (level >= levels.size()) levels.resize(level+1, Level());
+    return levels[level];
+  }
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include "TernarySim.h"
+
+TernarySim::TernarySim(Model & _model) :
+  model(_model), firstLatch(0), endLatch(0), stamp(0),
+  coneError(Minisat::lit_Undef)
+{
+  size_t n = model.numUnprimedVars();
+  if (model.beginLatches() != model.endLatches()) {
+    firstLatch = model.beginLatches()->index();
+    endLatch = firstLatch + (model.endLatches() - model.beginLatches());
+  }
+  cur.resize(n);
+  next.resize(n);
+  rowOf.assign(n, -1);
+  mark.assign(n, 0);
+  const AigVec & aig = model.andGates();
+  for (size_t i = 0; i < aig.size(); ++i)
+    rowOf[(size_t) Minisat::var(aig[i].lhs)] = (int) i;
+}
+
+// Collects the AIG rows in the cone of the roots in topological order
+// (the rows of the AIGER file need not be ordered), and the latches
+// in it.
+void TernarySim::cone(const LitVec & roots, vector<size_t> & rows,
+                      LitVec * latches)
+{
+  const AigVec & aig = model.andGates();
+  rows.clear();
+  if (latches) latches->clear();
+  if (++stamp == 0) {
+    mark.assign(mark.size(), 0);
+    stamp = 1;
+  }
+  // marked 2*stamp-1 when entered, 2*stamp when done
+  unsigned in = 2*stamp-1, done = 2*stamp;
+  for (LitVec::const_iterator r = roots.begin(); r != roots.end(); ++r) {
+    stack.push_back((size_t) Minisat::var(*r));
+    while (!stack.empty()) {
+      size_t v = stack.back();
+      if (mark[v] == done) { stack.pop_back(); continue; }
+      int row = rowOf[v];
+      if (row < 0) {
+        mark[v] = done;
+        stack.pop_back();
+        if (latches && isLatch(v)) latches->push_back(Minisat::mkLit((Minisat::Var) v));
+        continue;
+      }
+      if (mark[v] != in) {
+        mark[v] = in;
+        size_t v0 = (size_t) Minisat::var(aig[row].rhs0);
+        size_t v1 = (size_t) Minisat::var(aig[row].rhs1);
+        if (mark[v0] != done) stack.push_back(v0);
+        if (mark[v1] != done) stack.push_back(v1);
+        continue;
+      }
+      mark[v] = done;
+      stack.pop_back();
+      rows.push_back((size_t) row);
+    }
+  }
+}
+
+void TernarySim::simulate(vector<Value> & vals,
+                          const vector<size_t> & rows) const
+{
+  const AigVec & aig = model.andGates();
+  for (vector<size_t>::const_iterator i = rows.begin(); i != rows.end(); ++i) {
+    const AigRow & row = aig[*i];
+    Value a = value(vals, row.rhs0), b = value(vals, row.rhs1);
+    Value & o = vals[(size_t) Minisat::var(row.lhs)];
+    o.zero = a.zero | b.zero;
+    o.one = a.one & b.one;
+  }
+}
+
+bool TernarySim::lift(const LitVec & inputs, const LitVec & nextInputs,
+                      const LitVec & latches, const LitVec * succ,
+                      LitVec & lifted)
+{
+  const uint64_t all = ~(uint64_t) 0;
+  const Value X = { all, all };
+
+  // The successor is reached if it satisfies the primed error (unless
+  // succ is given) and the primed invariant constraints, which depend
+  // on the next-state functions of errorLatches ...
+  const LitVec & constraints = model.invariantConstraints();
+  bool primed = !succ || !constraints.empty();
+  if (primed && coneError != model.error()) {
+    coneError = model.error();
+    roots = constraints;
+    roots.push_back(coneError);
+    cone(roots, errorRows, &errorLatches);
+  }
+  // ... and the successor's latches.
+  roots.clear();
+  if (succ)
+    for (LitVec::const_iterator i = succ->begin(); i != succ->end(); ++i)
+      roots.push_back(model.nextStateFn(model.varOfLit(*i)));
+  if (primed)
+    for (LitVec::const_iterator i = errorLatches.begin();
+         i != errorLatches.end(); ++i)
+      roots.push_back(model.nextStateFn(model.varOfLit(*i)));
+  cone(roots, rows, NULL);
+
+  // constant, inputs, and latches outside of the state
+  Value f = { all, 0 };
+  cur[0] = next[0] = f;
+  for (VarVec::const_iterator i = model.beginInputs();
+       i != model.endInputs(); ++i)
+    cur[i->index()] = next[i->index()] = X;
+  for (VarVec::const_iterator i = model.beginLatches();
+       i != model.endLatches(); ++i)
+    cur[i->index()] = X;
+  for (LitVec::const_iterator i = inputs.begin(); i != inputs.end(); ++i) {
+    Value v = { 0, all };
+    if (Minisat::sign(*i)) std::swap(v.zero, v.one);
+    cur[(size_t) Minisat::var(*i)] = v;
+  }
+  for (LitVec::const_iterator i = nextInputs.begin();
+       i != nextInputs.end(); ++i) {
+    Value v = { 0, all };
+    if (Minisat::sign(*i)) std::swap(v.zero, v.one);
+    next[(size_t) Minisat::var(*i)] = v;
+  }
+
+  // Latches outside of the cone are dropped outright; the others are
+  // candidates, which start out as definite.
+  size_t n = latches.size();
+  dropped.assign(n, true);
+  cands.clear();
+  for (size_t i = 0; i < n; ++i)
+    if (inCone(latches[i])) {
+      dropped[i] = false;
+      cands.push_back(i);
+      Value v = { 0, all };
+      if (Minisat::sign(latches[i])) std::swap(v.zero, v.one);
+      cur[(size_t) Minisat::var(latches[i])] = v;
+    }
+  size_t m = cands.size();
+  for (size_t start = 0; ; ) {
+    // lane j drops candidates start, ..., start+j-1
+    for (size_t i = start; i < m && i - start < 63; ++i) {
+      Minisat::Lit la = latches[cands[i]];
+      Value v = { all << (i - start + 1), all };
+      if (Minisat::sign(la)) std::swap(v.zero, v.one);
+      cur[(size_t) Minisat::var(la)] = v;
+    }
+    simulate(cur, rows);
+    uint64_t ok = all;
+    if (succ)
+      for (LitVec::const_iterator i = succ->begin(); i != succ->end(); ++i) {
+        Minisat::Lit fn = model.nextStateFn(model.varOfLit(*i));
+        ok &= holds(cur, Minisat::sign(*i) ? ~fn : fn);
+      }
+    if (primed) {
+      for (LitVec::const_iterator i = errorLatches.begin();
+           i != errorLatches.end(); ++i)
+        next[(size_t) Minisat::var(*i)] =
+          value(cur, model.nextStateFn(model.varOfLit(*i)));
+      simulate(next, errorRows);
+      if (!succ) ok &= holds(next, model.error());
+      for (LitVec::const_iterator i = constraints.begin();
+           i != constraints.end(); ++i)
+        ok &= holds(next, *i);
+    }
+    if (start == 0 && !(ok & 1)) return false;
+    // X only ever spreads as more latches are dropped, so the
+    // successful lanes are a prefix: lanes 0, ..., r-1.
+    size_t r = 0;
+    while (r < 64 && (ok >> r & 1)) ++r;
+    assert (r > 0);
+    size_t d = min(r-1, m-start);
+    for (size_t i = start; i < start+d; ++i) {
+      dropped[cands[i]] = true;
+      cur[(size_t) Minisat::var(latches[cands[i]])] = X;
+    }
+    start += d;
+    if (start < m && r < 64) {
+      // the next candidate must stay
+      Minisat::Lit la = latches[cands[start++]];
+      Value v = { 0, all };
+      if (Minisat::sign(la)) std::swap(v.zero, v.one);
+      cur[(size_t) Minisat::var(la)] = v;
+    }
+    if (start == m) break;
+  }
+  lifted.clear();
+  for (size_t i = 0; i < n; ++i)
+    if (!dropped[i]) lifted.push_back(latches[i]);
+  return true;
+}
@@ -0,0 +1,106 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#ifndef TERNARYSIM_H_INCLUDED
+#define TERNARYSIM_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+#include "Model.h"
+
+// Lifts states by ternary (0/1/X) simulation of the AND section
+// rather than by a SAT query.  Latches of the state are replaced by X
+// in a given order for as long as the simulation still shows that
+// the successor is reached; what remains is the lifted state.
+//
+// The simulation is bit-parallel: each variable holds two 64-bit
+// masks, of the lanes in which it may be 0 and of those in which it
+// may be 1.  Lane j of a round drops the next j candidate latches, so
+// that a round decides up to 63 latches with one pass over the
+// relevant part of the AIG.
+class TernarySim {
+public:
+  TernarySim(Model & _model);
+
+  // Lifts the state of the given latches, which are ordered so that
+  // those to be dropped first come first, under the given primary
+  // inputs and primed primary inputs (over unprimed variables).  On
+  // success, lifted holds the remaining latches, in the given order,
+  // and every state that they describe, under the inputs, has a
+  // successor that satisfies the invariant constraints and is in succ
+  // (or, if succ is NULL, violates the property).  Returns false if
+  // not even the complete state can be shown to reach the successor,
+  // in which case the caller must lift by other means.
+  bool lift(const LitVec & inputs, const LitVec & nextInputs,
+            const LitVec & latches, const LitVec * succ,
+            LitVec & lifted);
+
+private:
+  Model & model;
+  size_t firstLatch, endLatch;  // variable indices of the latches
+
+  struct Value {
+    uint64_t zero, one;  // lanes in which the variable may be 0 / 1
+  };
+  vector<Value> cur, next;  // by variable: current and primed values
+
+  // AIG rows by output variable (or -1), and per-variable marks for
+  // collecting cones.
+  vector<int> rowOf;
+  vector<unsigned> mark;
+  unsigned stamp;
+
+  // The cone of the error and the invariant constraints, over primed
+  // variables, for the error it was computed for.
+  Minisat::Lit coneError;
+  vector<size_t> errorRows;
+  LitVec errorLatches;
+
+  vector<size_t> rows;  // scratch: cone of the current pass
+  LitVec roots;
+  vector<size_t> stack;
+  vector<bool> dropped;
+  vector<size_t> cands;  // indices of the latches in the cone
+
+  void cone(const LitVec & roots, vector<size_t> & rows, LitVec * latches);
+  // Whether lit's variable is in the cone most recently collected.
+  bool inCone(Minisat::Lit lit) const {
+    return mark[(size_t) Minisat::var(lit)] == 2*stamp;
+  }
+  void simulate(vector<Value> & vals, const vector<size_t> & rows) const;
+  Value value(const vector<Value> & vals, Minisat::Lit lit) const {
+    Value v = vals[(size_t) Minisat::var(lit)];
+    if (Minisat::sign(lit)) std::swap(v.zero, v.one);
+    return v;
+  }
+  // Lanes in which lit is certainly true.
+  uint64_t holds(const vector<Value> & vals, Minisat::Lit lit) const {
+    Value v = value(vals, lit);
+    return v.one & ~v.zero;
+  }
+  bool isLatch(size_t v) const { return v >= firstLatch && v < endLatch; }
+};
+
+#endif
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""Runs IC3 on the benchmark corpus and compares with a baseline.
+
+Each model of the corpus is checked under each configuration a number
+of times.  For each (model, configuration) pair, the median wall time,
+the peak resident set size, queries/sec, mics/sec, and the final k are
+reported (the latter three from IC3's -json profile of the median
+run).  With --baseline, each pair is compared with the stored result:
+a wrong answer, or a median wall time more than --threshold above the
+baseline's, fails the run.  --save writes the results as a new
+baseline.
+
+Wall times are only comparable on the same machine and build; keep
+baselines local (see the bench and bench-baseline make targets).
+"""
+
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+# name -> IC3 options.  The -seed runs are randomized but repeatable.
+CONFIGS = {
+    'default': [],
+    'basic': ['-b'],
+    'seed1': ['-seed', '1'],
+    'seed2': ['-seed', '2'],
+}
+
+
+def read_corpus(path):
+    models = []
+    with open(path) as f:
+        for line in f:
+            words = shlex.split(line, comments=True)
+            if not words:
+                continue
+            if len(words) < 2 or words[1] not in ('0', '1'):
+                sys.exit('%s: bad line: %s' % (path, line.strip()))
+            models.append((words[0], words[1], words[2:]))
+    return models
+
+
+def run(ic3, root, model, opts, timeout):
+    """Returns (answer, wall seconds, peak RSS in KiB, end record)."""
+    with tempfile.TemporaryDirectory() as tmp:
+        prof = os.path.join(tmp, 'profile.json')
+        out = os.path.join(tmp, 'stdout')
+        with open(os.path.join(root, model), 'rb') as stdin, \
+             open(out, 'wb') as stdout:
+            start = time.monotonic()
+            p = subprocess.Popen([ic3] + opts + ['-json', prof], cwd=root,
+                                 stdin=stdin, stdout=stdout,
+                                 stderr=subprocess.DEVNULL)
+            # reap through wait4 for the child's own rusage
+            while True:
+                pid, _, usage = os.wait4(p.pid, os.WNOHANG)
+                if pid:
+                    break
+                if time.monotonic() - start > timeout:
+                    p.kill()
+                    os.wait4(p.pid, 0)
+                    return 'timeout', float(timeout), 0, None
+                time.sleep(0.005)
+            wall = time.monotonic() - start
+            p.returncode = 0  # reaped: keep Popen from waiting again
+        with open(out, 'rb') as f:
+            words = f.read().decode(errors='replace').split()
+        answer = words[-1] if words else '?'
+        end = None
+        if os.path.exists(prof):
+            with open(prof) as f:
+                for line in f:
+                    rec = json.loads(line)
+                    if rec['event'] != 'frame':
+                        end = rec
+        return answer, wall, usage.ru_maxrss, end
+
+
+def median(xs):
+    xs = sorted(xs)
+    return xs[len(xs) // 2]
+
+
+def measure(args, root, models):
+    results = {}
+    for model, expected, extra in models:
+        for name in args.configs:
+            key = ' '.join([model] + extra) + ' | ' + name
+            runs = [run(args.ic3, root, model, extra + CONFIGS[name],
+                        args.timeout)
+                    for _ in range(args.reps)]
+            runs.sort(key=lambda r: r[1])
+            answer, wall, _, end = runs[len(runs) // 2]
+            r = {
+                'expected': expected,
+                'answer': answer,
+                'wall': wall,
+                'rss_kb': max(x[2] for x in runs),
+                'k': None, 'queries_per_sec': None, 'mics_per_sec': None,
+            }
+            if end and end.get('elapsed_ns'):
+                secs = end['elapsed_ns'] / 1e9
+                r['k'] = end['k']
+                r['queries_per_sec'] = round(end['queries'] / secs)
+                r['mics_per_sec'] = round(end['mics'] / secs)
+            if any(x[0] != answer for x in runs):
+                r['answer'] = 'unstable'
+            results[key] = r
+            report(key, r)
+    return results
+
+
+def fmt(x):
+    return '-' if x is None else str(x)
+
+
+def report(key, r):
+    print('%-44s %-8s %8.3fs %8d KiB  q/s %-8s mic/s %-7s k %s'
+          % (key, r['answer'], r['wall'], r['rss_kb'],
+             fmt(r['queries_per_sec']), fmt(r['mics_per_sec']), fmt(r['k'])))
+    sys.stdout.flush()
+
+
+def compare(results, baseline, threshold):
+    failures = []
+    for key, r in sorted(results.items()):
+        b = baseline.get(key)
+        if b is None:
+            print('%s: not in baseline' % key)
+            continue
+        ratio = r['wall'] / max(b['wall'], 1e-3)
+        print('%-44s wall %8.3fs -> %8.3fs (%+.1f%%)'
+              % (key, b['wall'], r['wall'], 100 * (ratio - 1)))
+        # ignore noise on runs too short to time
+        if ratio > 1 + threshold and r['wall'] - b['wall'] > 0.05:
+            failures.append('%s: %.3fs vs. baseline %.3fs'
+                            % (key, r['wall'], b['wall']))
+    return failures
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--ic3', default=os.path.join(root, 'IC3'))
+    ap.add_argument('--corpus', default=os.path.join(root, 'bench',
+                                                     'corpus.txt'))
+    ap.add_argument('--configs', default=','.join(CONFIGS),
+                    help='comma-separated subset of: ' + ', '.join(CONFIGS))
+    ap.add_argument('--reps', type=int, default=3)
+    ap.add_argument('--timeout', type=float, default=600,
+                    help='seconds per run')
+    ap.add_argument('--baseline', help='compare with this results file')
+    ap.add_argument('--threshold', type=float, default=0.10,
+                    help='allowed relative slowdown (default 0.10)')
+    ap.add_argument('--save', help='write the results to this file')
+    args = ap.parse_args()
+    args.ic3 = os.path.abspath(args.ic3)
+    args.configs = args.configs.split(',')
+    for name in args.configs:
+        if name not in CONFIGS:
+            ap.error('unknown configuration: ' + name)
+
+    results = measure(args, root, read_corpus(args.corpus))
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=1, sort_keys=True)
+            f.write('\n')
+    failures = ['%s: answer %s, expected %s'
+                % (key, r['answer'], r['expected'])
+                for key, r in sorted(results.items())
+                if r['answer'] != r['expected']]
+    if args.baseline:
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                failures += compare(results, json.load(f), args.threshold)
+        else:
+            print('no baseline at %s; run make bench-baseline' % args.baseline)
+    for f in failures:
+        print('FAIL ' + f)
+    print('bench: %s' % ('FAIL' if failures else 'PASS'))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
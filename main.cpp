@@ -21,41 +21,63 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <signal.h>
 #include <string>
 #include <time.h>
 
 extern "C" {
 #include "aiger.h"
 }
+#include "Checkpoint.h"
 #include "IC3.h"
 #include "Model.h"
+#include "Preprocess.h"
 #include "clausebuf.h"
 
+// The first SIGINT or SIGTERM makes the check stop at its next safe
+// point and report unknown; a second one terminates as usual.
+static void onSignal(int) {
+  IC3::interrupt();
+}
+
 int main(int argc, char ** argv) {
   unsigned int propertyIndex = 0;
-  bool basic = false, random = false;
-  int verbose = 0;
-  bool dump = false;
+  bool all = false, pp = false;
+  IC3::Options opts;
   ClauseBuf clsbuf;
   const char * fname = NULL;
+  const char * cacheDir = NULL;
+  std::ofstream json;
+  Checkpoint resumed;
 
   for (int i = 1; i < argc; ++i) {
     if (string(argv[i]) == "-v")
       // option: verbosity
-      verbose = 2;
+      opts.verbose = 2;
     else if (string(argv[i]) == "-s")
       // option: print statistics
-      verbose = max(1, verbose);
+      opts.verbose = max(1, opts.verbose);
     else if (string(argv[i]) == "-r") {
       // option: randomize the run, which is useful in performance
       // testing; default behavior is deterministic
       srand(time(NULL));
-      random = true;
+      opts.random = true;
+    }
+    else if (string(argv[i]) == "-seed") {
+      // option: randomize the run, repeatably, with the given seed
+      if (i+1 >= argc) {
+        cout << "missing seed for `-seed`" << endl;
+        return 0;
+      }
+      srand((unsigned) atoi(argv[++i]));
+      opts.random = true;
     }
     else if (string(argv[i]) == "-d") {
       // option: dump result to inv.cnf
-      dump = true;
+      opts.dump = true;
     }
     else if (string(argv[i]) == "-f") {
       // option: load frame from file
@@ -69,7 +91,7 @@ int main(int argc, char ** argv) {
         return 0;
       }
       cout << "Load " << clsbuf.clauses.size() << " clauses." << endl;
-      if (dump)
+      if (opts.dump)
         clsbuf.dump();
     } else if (string(argv[i]) == "-i") {
       // option: load aig from file
@@ -81,7 +103,106 @@ int main(int argc, char ** argv) {
     }
     else if (string(argv[i]) == "-b")
       // option: use basic generalization
-      basic = true;
+      opts.basic = true;
+    else if (string(argv[i]) == "-g")
+      // option: drop literals in chunks during generalization
+      opts.chunked = true;
+    else if (string(argv[i]) == "-t")
+      // option: lift CTIs by ternary simulation when possible
+      opts.ternary = true;
+    else if (string(argv[i]) == "-o")
+      // option: use one solver for all frames
+      opts.oneSolver = true;
+    else if (string(argv[i]) == "-j") {
+      // option: propagate clauses with N threads
+      if (i+1 >= argc || atoi(argv[i+1]) < 1) {
+        cout << "missing or invalid thread count for `-j`" << endl;
+        return 0;
+      }
+      opts.threads = (unsigned) atoi(argv[++i]);
+    }
+    else if (string(argv[i]) == "-mj") {
+      // option: try N literal drops at once in generalization
+      if (i+1 >= argc || atoi(argv[i+1]) < 1) {
+        cout << "missing or invalid thread count for `-mj`" << endl;
+        return 0;
+      }
+      opts.micThreads = (unsigned) atoi(argv[++i]);
+    }
+    else if (string(argv[i]) == "-p") {
+      // option: race N differently configured IC3 instances
+      if (i+1 >= argc || atoi(argv[i+1]) < 1) {
+        cout << "missing or invalid instance count for `-p`" << endl;
+        return 0;
+      }
+      opts.portfolio = (unsigned) atoi(argv[++i]);
+    }
+    else if (string(argv[i]) == "-x")
+      // option: exchange lemmas between portfolio instances
+      opts.share = true;
+    else if (string(argv[i]) == "-c") {
+      // option: cache the simplified transition relation in a directory
+      if (i+1 >= argc) {
+        cout << "missing directory for `-c`" << endl;
+        return 0;
+      }
+      cacheDir = argv[++i];
+    }
+    else if (string(argv[i]) == "-json") {
+      // option: write profile records to a file in JSON
+      if (i+1 >= argc) {
+        cout << "missing file name for `-json`" << endl;
+        return 0;
+      }
+      json.open(argv[++i]);
+      if (!json) {
+        cout << "Unable to open " << argv[i] << endl;
+        return 0;
+      }
+      opts.json = &json;
+    }
+    else if (string(argv[i]) == "--mem-limit") {
+      // option: keep resident memory below MB megabytes
+      if (i+1 >= argc || atoi(argv[i+1]) < 1) {
+        cout << "missing or invalid size for `--mem-limit`" << endl;
+        return 0;
+      }
+      opts.memLimit = (size_t) atoi(argv[++i]);
+    }
+    else if (string(argv[i]) == "--timeout") {
+      // option: stop with an unknown result after SEC seconds
+      if (i+1 >= argc || atof(argv[i+1]) <= 0) {
+        cout << "missing or invalid time for `--timeout`" << endl;
+        return 0;
+      }
+      opts.timeout = atof(argv[++i]);
+    }
+    else if (string(argv[i]) == "--checkpoint") {
+      // option: save the state of the run to a file as it progresses
+      if (i+1 >= argc) {
+        cout << "missing file name for `--checkpoint`" << endl;
+        return 0;
+      }
+      opts.checkpoint = argv[++i];
+    }
+    else if (string(argv[i]) == "--resume") {
+      // option: continue the run saved by --checkpoint
+      if (i+1 >= argc) {
+        cout << "missing file name for `--resume`" << endl;
+        return 0;
+      }
+      if (!resumed.read(argv[++i])) {
+        cout << "Unable to read from " << argv[i] << endl;
+        return 0;
+      }
+      opts.resume = &resumed;
+    }
+    else if (string(argv[i]) == "-pp")
+      // option: preprocess the AIG
+      pp = true;
+    else if (string(argv[i]) == "-a")
+      // option: check all properties
+      all = true;
     else
       // optional argument: set property index
       propertyIndex = (unsigned) atoi(argv[i]);
@@ -100,15 +221,64 @@ int main(int argc, char ** argv) {
     cout << msg << endl;
     return 0;
   }
+  AigMap aigMap;
+  if (pp) {
+    // keep the properties to be checked, which become bad states 0...
+    unsigned int n = aig->num_bad > 0 ? aig->num_bad : aig->num_outputs;
+    vector<unsigned> properties;
+    for (unsigned int i = 0; i < n; ++i)
+      if (all || i == propertyIndex)
+        properties.push_back(i);
+    if (properties.empty()) {
+      cout << "Bad property index specified." << endl;
+      return 0;
+    }
+    aiger * pre = preprocess(aig, properties, aigMap);
+    if (opts.verbose)
+      cout << "Preprocessed: " << aig->num_latches << " -> " << pre->num_latches
+           << " latches, " << aig->num_ands << " -> " << pre->num_ands
+           << " ANDs" << endl;
+    aiger_reset(aig);
+    aig = pre;
+    propertyIndex = 0;
+    opts.aigMap = &aigMap;
+    // ... and restate the loaded lemmas over the remaining latches
+    vector<vector<int> > lemmas;
+    for (size_t i = 0; i < clsbuf.clauses.size(); ++i)
+      if (aigMap.toPreprocessed(clsbuf.clauses[i]))
+        lemmas.push_back(clsbuf.clauses[i]);
+    clsbuf.clauses.swap(lemmas);
+  }
   // create the Model from the obtained aig
-  Model * model = modelFromAiger(aig, propertyIndex);
+  Model * model = all 
+    ? multiModelFromAiger(aig) 
+    : modelFromAiger(aig, propertyIndex);
   aiger_reset(aig);
   if (!model) return 0;
+  if (cacheDir) model->setTRCacheDir(cacheDir);
+  if (opts.resume && !resumed.fits(*model)) {
+    cout << "Checkpoint is not of this model" << endl;
+    delete model;
+    return 0;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof sa);
+  sa.sa_handler = onSignal;
+  sa.sa_flags = SA_RESETHAND;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
 
   // model check it
-  bool rv = IC3::check(*model, clsbuf,verbose, basic, random, dump);
-  // print 0/1 according to AIGER standard
-  cout << !rv << endl;
+  if (all)
+    // prints "<property ID> <0/1/2>" per property
+    IC3::checkAll(*model, clsbuf, opts);
+  else {
+    IC3::Result rv = IC3::check(*model, clsbuf, opts);
+    // print 0/1 according to AIGER standard (2: unknown)
+    cout << rv << endl;
+  }
 
   delete model;
 
@@ -0,0 +1,363 @@
+/*********************************************************************
+Copyright (c) 2013, Hongce Zhang
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+// Microbenchmarks of IC3's hot kernels:
+//
+//   ./microbench [-n N] [-w N] [-seed N] [-b] [-g] [-t] [-o] [-j N]
+//                [<property ID>] < <AIGER file>
+//
+// IC3 first runs to completion on the model, and the lemmas of its
+// frames are recorded.  Each kernel is then timed by itself, N times
+// (default 1000) after N' untimed warm-up runs (-w, default 100), on
+// those frames or on fresh IC3 instances into which the recorded
+// lemmas are replayed, and the distribution of its latency is
+// printed.  -b, -g, -t, -o, and -j configure the instances as for
+// IC3.
+// The model should be one that IC3 solves in seconds.
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// The IC3 class is private to IC3.cpp, which is compiled into this
+// program in place of IC3.o.
+#include "IC3.cpp"
+
+namespace IC3 {
+
+  class KernelBench {
+  public:
+    KernelBench(Model & _model, const Options & _opts, size_t _warmup,
+                size_t _samples, unsigned _seed) :
+      model(_model), opts(_opts), warmup(_warmup), samples(_samples),
+      seed(_seed), rec(_model)
+    {
+      configure(rec, opts, 0);
+    }
+
+    void run() {
+      ClauseBuf none;
+      uint64_t t = Profile::now();
+      bool rv = rec.check(none);
+      cout << "recorded run: " << (rv ? "proved" : "failed") << ", k = "
+           << rec.k << ", " << (Profile::now() - t) / 1000000 << " ms" 
+           << endl;
+      for (size_t i = 1; i < rec.frames.size(); ++i) {
+        rec.compact(i);
+        for (CubeIdVec::const_iterator j = rec.frames[i].borderCubes.begin();
+             j != rec.frames[i].borderCubes.end(); ++j)
+          lemmas.push_back(make_pair(i, LitVec(rec.cubes.begin(*j),
+                                               rec.cubes.end(*j))));
+      }
+      cout << "recorded lemmas: " << lemmas.size() << endl << endl;
+      cout << left << setw(22) << "kernel" << right << setw(8) << "samples";
+      const char * cols[] = { "min", "p50", "p90", "p99", "max", "mean" };
+      for (size_t i = 0; i < 6; ++i)
+        cout << setw(10) << cols[i];
+      cout << "  (us)" << endl;
+
+      benchConsecution();
+      benchStateOf();
+      if (lemmas.empty()) {
+        cout << "(no lemmas: skipping the remaining kernels)" << endl;
+        return;
+      }
+      benchAddCube();
+      benchCompact();
+      benchPush();
+      // last, as they add CTG lemmas to the recorded frames
+      benchCtgDown();
+      benchMic();
+    }
+
+  private:
+    Model & model;
+    Options opts;
+    size_t warmup, samples;
+    unsigned seed;
+    IC3 rec;  // the recorded run
+    vector< pair<size_t, LitVec> > lemmas;  // (level, cube)
+
+    // Calls sample() until it has returned samples + warmup times,
+    // and prints the distribution of the latencies (in ns) that it
+    // returned after the warm-up.  sample() may do untimed setup
+    // work, and returns the time of the kernel alone.
+    template <class F> void measure(const char * name, F sample) {
+      vector<uint64_t> ns;
+      ns.reserve(samples);
+      for (size_t i = 0; i < warmup + samples; ++i) {
+        uint64_t t = sample();
+        if (i >= warmup) ns.push_back(t);
+      }
+      sort(ns.begin(), ns.end());
+      uint64_t sum = 0;
+      for (size_t i = 0; i < ns.size(); ++i) sum += ns[i];
+      cout << left << setw(22) << name << right << setw(8) << ns.size()
+           << fixed << setprecision(2);
+      if (!ns.empty()) {
+        size_t ps[] = { 0, ns.size() / 2, ns.size() * 9 / 10,
+                        ns.size() * 99 / 100, ns.size() - 1 };
+        for (size_t i = 0; i < 5; ++i)
+          cout << setw(10) << ns[ps[i]] / 1000.0;
+        cout << setw(10) << sum / 1000.0 / ns.size();
+      }
+      cout << endl;
+    }
+
+    const pair<size_t, LitVec> & anyLemma() {
+      return lemmas[rand_r(&seed) % lemmas.size()];
+    }
+
+    // A fresh instance with the recorded run's frames and literal
+    // order, but no lemmas.
+    IC3 * blank() {
+      IC3 * ic3 = new IC3(model);
+      configure(*ic3, opts, 0);
+      ic3->k = rec.k;
+      ic3->extend();
+      ic3->litOrder = rec.litOrder;
+      ic3->earliest = ic3->k+1;
+      ic3->trivial = false;
+      return ic3;
+    }
+
+    // Adds each recorded lemma to ic3 at its level less lower (but at
+    // least 1).
+    void replay(IC3 & ic3, size_t lower) {
+      for (size_t i = 0; i < lemmas.size(); ++i) {
+        LitVec cube = lemmas[i].second;
+        ic3.addCube(max(lemmas[i].first, lower+1) - lower, cube, true, true);
+      }
+    }
+
+    // A lemma of frame i holds relative to frame i-1 (unsat); whether
+    // it holds relative to frame i decides whether it is pushed.
+    void benchConsecution() {
+      if (lemmas.empty()) return;
+      measure("consecution/holds", [&]() -> uint64_t {
+          const pair<size_t, LitVec> & l = anyLemma();
+          LitVec core;
+          uint64_t t = Profile::now();
+          rec.consecution(l.first-1, l.second, 0, &core);
+          return Profile::now() - t;
+        });
+      measure("consecution/push", [&]() -> uint64_t {
+          const pair<size_t, LitVec> & l = anyLemma();
+          size_t i = min(l.first, rec.k);
+          LitVec core;
+          uint64_t t = Profile::now();
+          rec.consecution(i, l.second, 0, &core);
+          return Profile::now() - t;
+        });
+    }
+
+    // Lifts a random transition out of a frame to its successor.
+    void benchStateOf() {
+      size_t nLatches = model.endLatches() - model.beginLatches();
+      LitVec succ;
+      measure("stateOf", [&]() -> uint64_t {
+          size_t i = 1 + rand_r(&seed) % rec.k;
+          Minisat::Solver & slv = *rec.frames[i].consecution;
+          // vary the transition by fixing a few latches at random
+          bool sat = false;
+          for (size_t tries = 0; !sat && tries <= 10; ++tries) {
+            IC3::MSLitVec assumps;
+            rec.frameAssumps(i, assumps);
+            for (size_t j = 0; j < 3 && tries < 10 && nLatches; ++j)
+              assumps.push(model.beginLatches()[rand_r(&seed) % nLatches]
+                           .lit(rand_r(&seed) & 1));
+            sat = slv.solve(assumps);
+          }
+          if (!sat) return 0;  // frame i has no successors
+          succ.clear();
+          for (VarVec::const_iterator l = model.beginLatches();
+               l != model.endLatches(); ++l) {
+            Minisat::lbool val = slv.modelValue(model.primeVar(*l).var());
+            if (val != Minisat::l_Undef)
+              succ.push_back(l->lit(val == Minisat::l_False));
+          }
+          size_t st = rec.newState();
+          rec.state(st).successor = 0;
+          rec.state(st).latches = rec.putLits(succ);
+          uint64_t t = Profile::now();
+          rec.stateOf(rec.frames[i], st);
+          t = Profile::now() - t;
+          rec.resetStates();
+          return t;
+        });
+    }
+
+    // Each sample adds one recorded lemma to a fresh instance.
+    void benchAddCube() {
+      IC3 * ic3 = NULL;
+      size_t next = 0;
+      measure("addCube", [&]() -> uint64_t {
+          if (!ic3 || next == lemmas.size()) {
+            delete ic3;
+            ic3 = blank();
+            next = 0;
+          }
+          LitVec cube = lemmas[next].second;
+          uint64_t t = Profile::now();
+          ic3->addCube(lemmas[next].first, cube, true, true);
+          t = Profile::now() - t;
+          ++next;
+          return t;
+        });
+      delete ic3;
+    }
+
+    // The clean-up step of propagate(), after every lemma has moved
+    // up from frame 1.
+    void benchCompact() {
+      measure("propagate/compact", [&]() -> uint64_t {
+          IC3 * ic3 = blank();
+          replay(*ic3, rec.k);  // all to frame 1
+          replay(*ic3, 0);
+          uint64_t t = Profile::now();
+          for (size_t i = ic3->k+1; i >= 1; --i)
+            ic3->compact(i);
+          t = Profile::now() - t;
+          delete ic3;
+          return t;
+        });
+    }
+
+    // The push step of propagate(), with every lemma one frame short
+    // of where the recorded run left it.
+    void benchPush() {
+      measure(opts.threads > 1 ? "propagate/pushPar." : "propagate/push", 
+              [&]() -> uint64_t {
+          IC3 * ic3 = blank();
+          replay(*ic3, 1);
+          uint64_t t = Profile::now();
+          if (opts.threads > 1 && !opts.oneSolver)
+            ic3->pushParallel();
+          else
+            ic3->push();
+          t = Profile::now() - t;
+          delete ic3;
+          return t;
+        });
+    }
+
+    // A lemma of frame i, extended by the compatible literals of
+    // another lemma of frame i, which yields a weaker clause that
+    // still holds relative to frame i-1 and contains no initial state.
+    size_t extendedLemma(LitVec & cube) {
+      const pair<size_t, LitVec> & l = anyLemma();
+      cube = l.second;
+      for (size_t tries = 0; tries < 10; ++tries) {
+        const pair<size_t, LitVec> & m = anyLemma();
+        if (m.first != l.first || m.second == l.second) continue;
+        for (LitVec::const_iterator i = m.second.begin();
+             i != m.second.end(); ++i)
+          if (find(cube.begin(), cube.end(), ~*i) == cube.end()
+              && find(cube.begin(), cube.end(), *i) == cube.end())
+            cube.push_back(*i);
+        break;
+      }
+      return l.first;
+    }
+
+    // One attempt to drop a literal of an extended lemma.
+    void benchCtgDown() {
+      LitVec cube;
+      measure("ctgDown", [&]() -> uint64_t {
+          size_t i = extendedLemma(cube);
+          rec.orderCube(cube);
+          cube.erase(cube.begin());
+          uint64_t t = Profile::now();
+          rec.ctgDown(i-1, cube, 0, 1);
+          t = Profile::now() - t;
+          rec.resetStates();
+          return t;
+        });
+    }
+
+    void benchMic() {
+      LitVec cube;
+      measure("mic", [&]() -> uint64_t {
+          size_t i = extendedLemma(cube);
+          uint64_t t = Profile::now();
+          rec.mic(i-1, cube);
+          t = Profile::now() - t;
+          rec.resetStates();
+          return t;
+        });
+    }
+  };
+
+}
+
+int main(int argc, char ** argv) {
+  unsigned propertyIndex = 0;
+  size_t warmup = 100, samples = 1000;
+  unsigned seed = 1;
+  IC3::Options opts;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if ((arg == "-n" || arg == "-w" || arg == "-seed" || arg == "-j")
+        && i+1 >= argc) {
+      cout << "missing argument for `" << arg << "`" << endl;
+      return 0;
+    }
+    if (arg == "-n")
+      samples = (size_t) atoi(argv[++i]);
+    else if (arg == "-w")
+      warmup = (size_t) atoi(argv[++i]);
+    else if (arg == "-seed")
+      seed = (unsigned) atoi(argv[++i]);
+    else if (arg == "-j")
+      opts.threads = max(1, atoi(argv[++i]));
+    else if (arg == "-b")
+      opts.basic = true;
+    else if (arg == "-g")
+      opts.chunked = true;
+    else if (arg == "-t")
+      opts.ternary = true;
+    else if (arg == "-o")
+      opts.oneSolver = true;
+    else
+      propertyIndex = (unsigned) atoi(argv[i]);
+  }
+
+  aiger * aig = aiger_init();
+  const char * msg = aiger_read_from_file(aig, stdin);
+  if (msg) {
+    cout << msg << endl;
+    return 0;
+  }
+  Model * model = modelFromAiger(aig, propertyIndex);
+  aiger_reset(aig);
+  if (!model) return 0;
+  if (!IC3::baseCases(*model)) {
+    cout << "the property fails in at most one step" << endl;
+    delete model;
+    return 0;
+  }
+  IC3::KernelBench(*model, opts, warmup, samples, seed).run();
+  delete model;
+  return 1;
+}